@@ -69,6 +69,7 @@ class PortWrapper;
 class ClockDomain;
 class WavesSignal;
 class WavesFifo;
+class WavesSnapshot;
 struct Waves;
 
 extern __thread ClockDomain *t_currentClockDomain;
@@ -107,7 +108,6 @@ class ClockDomain
 {
     DECLARE_NOCOPY(ClockDomain);
 
-    typedef std::multimap<int, IEvent *> EventMap;
     friend struct Waves;
     friend class PortStorage;
     friend void forallThreaded (int id);
@@ -186,6 +186,8 @@ public:
     // Sort the update functions and create the update tree
     void sortUpdateFunctions ();
     void createUpdateArray ();
+    void coalesceTriggers (UpdateWrapper *w);
+    static bool getCoalescedTrigger (PortWrapper *port, intptr_t &target, int &delay, byte *&value);
     void setUpdateOffsets (UpdateWrapper *w);
     void writeUpdates (UpdateWrapper *w);
     int writeTriggers (UpdateWrapper *w, byte *&dst);
@@ -201,6 +203,9 @@ public:
     // or return NULL if there is no domain that contains the data.
     static ClockDomain *findOwner (const byte *data);
 
+    // Append the statistics of all fifos (cascade.FifoStats) to stats
+    static void getFifoStats (std::vector<FifoStats> &stats);
+
     // Register a verilog clock port with this clock domain
     void registerVerilogClock (vpiHandle port);
 
@@ -227,9 +232,33 @@ public:
     void tick ();     // main tick() function
     void postTick (); // reset ports and do scheduled events
 
+    // Idle edge skipping (cascade.SkipIdleEdges).  A rising edge can be skipped
+    // if enough of the previous rising edges ran no component code to drain the
+    // register delay chains and nothing is scheduled or active for this one; 
+    // only the edge bookkeeping is then performed, plus the register copies of
+    // domains whose registers are fed from outside the domain.
+    bool isIdle ();
+    bool isDrained ();
+    void skipEdge ();
+    static void tickSkippedRegisters (ClockDomain *runList);
+    static void wakeDomains ();
+    void wakeDomain ();
+
+    // Skip edges up to limit while every scheduled domain is idle
+    static void skipIdleTime (uint64 limit);
+
+    // The sequence of clock edges of the automatically scheduled domains is 
+    // periodic (for periods and rational clock ratios that are whole numbers of
+    // picoseconds), so the changes that rescheduling makes to the domain lists 
+    // are recorded over one period and then replayed instead of recomputing the
+    // edge times and searching the lists (cascade.ClockScheduleSize).
+    static void rescheduleDomains (ClockDomain *runList);
+    static void buildSchedule ();
+
     // Synchronous fifo updates
-    void schedulePush (GenericFifo *fifo);
-    void schedulePop (GenericFifo *fifo);
+    void schedulePush (GenericFifo *fifo, int count = 1);
+    void schedulePop (GenericFifo *fifo, int count = 1);
+    void receiveFifoPushes ();
 
     // Get the clock period
     inline int getPeriod () const 
@@ -255,8 +284,8 @@ public:
     static void runSimulation (uint64 runUntil);
 
     // Simulate a rising clock edge for the list of clock domains defined by
-    // m_nextSameTick
-    static void tickDomains (ClockDomain *runList);
+    // m_nextSameTick, optionally skipping the edges of idle domains
+    static void tickDomains (ClockDomain *runList, bool skipIdle = false);
 
     // Returns the number of rising clock edges (including the current one if
     // called from an update function).
@@ -268,6 +297,12 @@ public:
     // Schedule an event for some time in the future
     void scheduleEvent (int delay, IEvent *event);
 
+    // Schedule an event for an absolute time in picoseconds.  Events scheduled
+    // by this domain during a clock edge are buffered and added to the global
+    // queue once the edge completes so that the order is deterministic.
+    static void scheduleTimedEvent (uint64 time, IEvent *event);
+    void flushTimedEvents ();
+
     // Drive Verilog clock ports
     void driveVerilogClocks ();
 
@@ -275,12 +310,14 @@ public:
     void dumpWaves ();
     void dumpRegQs ();
     void dumpClocks ();
+    static void dumpGlobalWaves (ClockDomain *runList);
 
     //----------------------------------
     // Archiving
     //----------------------------------
 
     static void archiveClockDomains (Archive &ar);
+    static void archiveTimedEvents (Archive &ar);
     void archive (Archive &ar);
 
 private:
@@ -308,6 +345,7 @@ private:
 
     // Rising clock edge
     descore::PointerVector<Component *> m_tickableComponents; // Components with tick() defined
+    descore::PointerVector<Component *> m_updateComponents;   // Components with update functions in m_updates
     stack<vpiHandle>   m_verilogClocks;   // List of verilog clock ports to drive
 
     // Update array
@@ -318,19 +356,30 @@ private:
 
     // Events scheduled for a future rising clock edge
     TriggerStack         *m_syncTriggers;   // Triggers scheduled for after the clock tick
-    stack<GenericFifo *> *m_syncFifoPush;   // Fifo pushes scheduled for a future rising clock edge
-    stack<GenericFifo *> *m_syncFifoPop;    // Fifo pops scheduled for a future rising clock edge
+    stack<GenericFifo *> *m_syncFifos;      // Fifos with pushes/pops scheduled for a future rising clock edge
     int m_syncIndex;                        // Next set of vectors to fire
     int m_syncDepth;                        // Depth of sync vector arrays (power of two)
     int m_syncMask;                         // = m_syncDepth - 1
-    EventMap m_events;                      // Generic explicitly-registered events with arbitrary delay
+    EventWheel m_events;                    // Generic explicitly-registered events with arbitrary delay
+    stack<TimedEvent> m_timedEvents;        // Timed events scheduled during the current clock edge
+
+    // Idle edge skipping
+    bool m_canSkipEdges; // No placeholder updates with triggers that must be evaluated on every edge
+    bool m_externalRegs; // Registers fed from other domains or wires, which shift on skipped edges too
+    bool m_quiet;        // The current rising edge has run no component code so far
+    int  m_quietEdges;   // Number of consecutive rising edges that ran no component code
+    bool m_skipEdge;     // The current edge is being skipped
+    int64 m_idleEpoch;   // Value of s_idleEpoch when this domain was counted in s_numIdleDomains
 
     // Wave dumping
     Cascade::WavesSignal        *m_waveSignals;
     Cascade::WavesSignal        *m_waveRegQs;
     Cascade::WavesSignal        *m_waveClocks;
     Cascade::WavesFifo          *m_waveFifos;
+    Cascade::WavesSnapshot      *m_waveSnapshot;     // Change detection for m_waveSignals
+    Cascade::WavesSnapshot      *m_waveRegQSnapshot; // Change detection for m_waveRegQs
     static Cascade::WavesSignal *s_globalWaves;
+    static Cascade::WavesSnapshot *s_globalWavesSnapshot; // Change detection for s_globalWaves
 
     // Initialization
     UpdateWrapper *m_updateWrappers; // List of update functions belonging to this clock domain
@@ -363,6 +412,49 @@ private:
     static int s_numClockDomains;
     static time_t s_lastDeadlockCheckTime;
     static ClockDomain *s_defaultClockDomain; // Clock domain for top-level components with no explicit domain
+    static TimedEventQueue s_timedEvents;     // Events scheduled for an absolute time in picoseconds
+    static int s_numScheduledDomains;         // Number of automatically scheduled clock domains
+    static int s_numIdleDomains;              // Scheduled domains that have skipped an edge since the last full rising edge
+    static int64 s_idleEpoch;                 // Incremented on every full rising edge
+
+    // Precomputed clock edge schedule
+    struct ScheduleLink
+    {
+        ClockDomain *domain;
+        ClockDomain *nextDifferentTick;
+        ClockDomain *nextSameTick;
+        ClockDomain *lastSameTick;
+        int64        nextEdge;  // Relative to the start of the schedule period
+
+        // Compare with another link whose next edge is shift ps earlier
+        inline bool matches (const ScheduleLink &rhs, int64 shift) const
+        {
+            return (domain == rhs.domain) && 
+                (nextDifferentTick == rhs.nextDifferentTick) && 
+                (nextSameTick == rhs.nextSameTick) && 
+                (lastSameTick == rhs.lastSameTick) && 
+                (nextEdge == rhs.nextEdge + shift);
+        }
+    };
+    struct ScheduleStep
+    {
+        ClockDomain *first;     // Head of the schedule following this step
+        int          firstLink; // Index in s_scheduleLinks of the domains modified by this step
+        int          numLinks;
+    };
+    enum ScheduleState
+    {
+        ScheduleNone,    // Not yet built
+        ScheduleReady,   // Built and in use
+        ScheduleDynamic  // Not periodic within cascade.ClockScheduleSize steps
+    };
+    static void getScheduleLinks (std::vector<ScheduleLink> &links, int64 start);
+    static std::vector<ScheduleStep> s_schedule;
+    static std::vector<ScheduleLink> s_scheduleLinks;
+    static ScheduleState s_scheduleState;
+    static int s_scheduleIndex;               // Next step in s_schedule
+    static int64 s_scheduleBase;              // Start time of the current schedule period
+    static int64 s_schedulePeriod;            // Length of the schedule period in picoseconds
 };
 
 END_NAMESPACE_CASCADE
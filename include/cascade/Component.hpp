@@ -187,6 +187,34 @@ public:
         scheduleEventInternal(delay, new typename Cascade::MethodEventType<fn_t>::ev_t(this, fn, a1, a2, a3, a4));
     }
 
+    // Schedule an event for a time delay picoseconds in the future, independent
+    // of any clock domain.  Timed events fire before any clock edges at the same time.
+    template <typename fn_t>
+    inline void scheduleTimedEvent (uint64 delay, fn_t fn)
+    {
+        scheduleTimedEventInternal(delay, new typename Cascade::MethodEventType<fn_t>::ev_t(this, fn));
+    }
+    template <typename fn_t, typename A1>
+    inline void scheduleTimedEvent (uint64 delay, fn_t fn, A1 a1)
+    {
+        scheduleTimedEventInternal(delay, new typename Cascade::MethodEventType<fn_t>::ev_t(this, fn, a1));
+    }
+    template <typename fn_t, typename A1, typename A2>
+    inline void scheduleTimedEvent (uint64 delay, fn_t fn, A1 a1, A2 a2)
+    {
+        scheduleTimedEventInternal(delay, new typename Cascade::MethodEventType<fn_t>::ev_t(this, fn, a1, a2));
+    }
+    template <typename fn_t, typename A1, typename A2, typename A3>
+    inline void scheduleTimedEvent (uint64 delay, fn_t fn, A1 a1, A2 a2, A3 a3)
+    {
+        scheduleTimedEventInternal(delay, new typename Cascade::MethodEventType<fn_t>::ev_t(this, fn, a1, a2, a3));
+    }
+    template <typename fn_t, typename A1, typename A2, typename A3, typename A4>
+    inline void scheduleTimedEvent (uint64 delay, fn_t fn, A1 a1, A2 a2, A3 a3, A4 a4)
+    {
+        scheduleTimedEventInternal(delay, new typename Cascade::MethodEventType<fn_t>::ev_t(this, fn, a1, a2, a3, a4));
+    }
+
 public:
     Component *parentComponent; // pointer to parent component (NULL for top-level components)
     Component *childComponent;  // pointer to first child component
@@ -331,6 +359,7 @@ public:
 
     // Schedule an event
     void scheduleEventInternal (int delay, Cascade::IEvent *event);
+    void scheduleTimedEventInternal (uint64 delay, Cascade::IEvent *event);
 
     // Set the component id during initialization
     void setComponentId (uint16 id) 
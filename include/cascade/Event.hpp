@@ -65,6 +65,23 @@ template <typename ev_t> int getEventTypeId (bool mustExist = true);
 template <typename fn_t> fn_t getEvent (int id);
 template <typename fn_t> int getEventId (fn_t fn, bool mustExist = true);
 
+/////////////////////////////////////////////////////////////////
+//
+// Event storage.  Events are allocated from per-thread slabs and
+// recycled through per-thread free lists of each size class, so
+// scheduling an event doesn't go through the heap.
+//
+/////////////////////////////////////////////////////////////////
+struct EventPool
+{
+    static const int granularity = 16;        // Size classes are multiples of this
+    static const int maxPooledSize = 256;     // Larger events use the heap
+    static const int slabSize = 64 * 1024;
+
+    static void *alloc (size_t numBytes);
+    static void free (void *event, size_t numBytes);
+};
+
 /////////////////////////////////////////////////////////////////
 //
 // Event base interface
@@ -72,8 +89,18 @@ template <typename fn_t> int getEventId (fn_t fn, bool mustExist = true);
 /////////////////////////////////////////////////////////////////
 struct IEvent
 {
+    IEvent () : m_nextEvent(NULL), m_eventTick(0) {}
     virtual ~IEvent () {}
 
+    static void *operator new (size_t numBytes)
+    {
+        return EventPool::alloc(numBytes);
+    }
+    static void operator delete (void *event, size_t numBytes)
+    {
+        EventPool::free(event, numBytes);
+    }
+
     // Execute the event
     virtual void fireEvent () = 0;
 
@@ -86,6 +113,142 @@ struct IEvent
     // Determine if two events are the same
     bool equals (const IEvent *rhs) const;
     virtual bool _equals (const IEvent *rhs) const = 0;
+
+    // Used by EventWheel
+    IEvent *m_nextEvent; // Next event in the same wheel slot
+    int     m_eventTick; // Tick at which the event fires
+};
+
+/////////////////////////////////////////////////////////////////
+//
+// EventWheel
+//
+// Timing wheel of events indexed by clock domain tick.  Events
+// that fire within wheelSize ticks are kept in a per-tick slot;
+// events with longer delays are kept in an ordered overflow map
+// and moved into the wheel when they come within range.  Events
+// with the same tick fire in the order in which they were
+// scheduled.
+//
+/////////////////////////////////////////////////////////////////
+class EventWheel
+{
+    DECLARE_NOCOPY(EventWheel);
+public:
+    EventWheel ();
+    ~EventWheel ();
+
+    // Schedule an event for a future tick (the current tick is now)
+    void schedule (int now, int tick, IEvent *event);
+
+    // Return true if an event equal to the given one is scheduled for tick
+    bool contains (int now, int tick, const IEvent *event);
+
+    // Fire and delete the events scheduled for the current tick
+    inline void fireEvents (int now)
+    {
+        if (m_numEvents)
+            fireEventsInternal(now);
+    }
+
+    // Return true if there are events scheduled for the current tick
+    inline bool isDue (int now) const
+    {
+        return m_numEvents && (m_slots[now & (wheelSize - 1)].head || 
+                               (!m_overflow.empty() && (m_overflow.begin()->first == now)));
+    }
+
+    // Delete all events
+    void clear ();
+
+    // Number of scheduled events
+    inline int size () const
+    {
+        return m_numEvents;
+    }
+
+    // Archive the events in the same format as a std::multimap<int, IEvent *>
+    void archive (Archive &ar, int now);
+
+private:
+    static const int wheelSize = 256;
+    typedef std::multimap<int, IEvent *> EventMap;
+
+    void fireEventsInternal (int now);
+    void migrate (int now);
+    void insert (IEvent *event);
+
+    struct Slot
+    {
+        IEvent *head;
+        IEvent *tail;
+    };
+    Slot     m_slots[wheelSize];
+    EventMap m_overflow;  // Events that fire at least wheelSize ticks after the last migration
+    int      m_numEvents;
+};
+
+/////////////////////////////////////////////////////////////////
+//
+// TimedEventQueue
+//
+// Global queue of events scheduled for an absolute simulation
+// time in picoseconds rather than for a clock domain tick.  All
+// events with the same time are kept in a single list and fire
+// as one batch in the order in which they were scheduled.
+//
+/////////////////////////////////////////////////////////////////
+struct TimedEvent
+{
+    uint64  time;
+    IEvent *event;
+};
+
+class TimedEventQueue
+{
+    DECLARE_NOCOPY(TimedEventQueue);
+public:
+    TimedEventQueue ();
+    ~TimedEventQueue ();
+
+    // Schedule an event for the specified time
+    void schedule (uint64 time, IEvent *event);
+
+    // Return true if an event equal to the given one is scheduled for time
+    bool contains (uint64 time, const IEvent *event) const;
+
+    // Number of scheduled events
+    inline int size () const
+    {
+        return m_numEvents;
+    }
+
+    // Time of the next batch of events (the queue must be non-empty)
+    inline uint64 nextTime () const
+    {
+        assert(m_numEvents);
+        return m_batches.begin()->first;
+    }
+
+    // Fire and delete the next batch of events
+    void fireEvents ();
+
+    // Delete all events
+    void clear ();
+
+    // Archive the events
+    void archive (Archive &ar);
+
+private:
+    struct Batch
+    {
+        IEvent *head;
+        IEvent *tail;
+    };
+    typedef std::map<uint64, Batch> BatchMap;
+
+    BatchMap m_batches;
+    int      m_numEvents;
 };
 
 Archive &operator| (Archive &ar, IEvent *&event);
@@ -48,12 +48,43 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Ports.hpp"
 #include "Component.hpp"
+#include <descore/Thread.hpp>
 
 class Archive;
 class Sim;
 
 BEGIN_NAMESPACE_CASCADE
 
+template <typename T> class FifoPort;
+
+/////////////////////////////////////////////////////////////////
+//
+// FifoSpan
+//
+// Zero-copy view of the first entries of a fifo.  These occupy
+// at most two contiguous segments of the ring.  Fifo entries are
+// stored at decreasing addresses, so entry i of a segment is
+// found at seg[-i].
+//
+/////////////////////////////////////////////////////////////////
+template <typename T>
+struct FifoSpan
+{
+    const T *seg[2]; // First entry of each segment
+    int     len[2];  // Number of entries in each segment
+
+    inline int size () const
+    {
+        return len[0] + len[1];
+    }
+
+    inline const T &operator[] (int index) const
+    {
+        assert((unsigned) index < (unsigned) size());
+        return (index < len[0]) ? seg[0][-index] : seg[1][len[0] - index];
+    }
+};
+
 #define MAX_INITIAL_FIFO_SIZE 16
 
 // Sneak this into PortWrapper::connection
@@ -64,14 +95,60 @@ enum FifoType
     FIFO_NOWRITER
 };
 
+// Pushes/pops of a fifo with delay that become visible at one sync slot
+// of the consumer clock domain
+struct FifoPending
+{
+    uint32 push;
+    uint32 pop;
+};
+
+#define FIFO_CACHE_LINE_SIZE 64
+
+struct GenericFifo;
+
+// Channel for a fifo with delay whose producer is in a different clock
+// domain.  The producer thread publishes the running count of pushed
+// entries; the consumer clock domain picks up new entries at its next
+// rising edge and schedules their visibility in its own sync slots.  The
+// producer and consumer counters are kept on separate cache lines.
+struct FifoChannel
+{
+    volatile int pushed;   // Written by the producer only
+    byte         producerPad[FIFO_CACHE_LINE_SIZE - sizeof(int)];
+    GenericFifo  *fifo;
+    int          received; // Accessed by the consumer only
+    byte         consumerPad[FIFO_CACHE_LINE_SIZE - sizeof(GenericFifo *) - sizeof(int)];
+};
+
+// Fifo state that the common push and pop paths don't need.  It is kept
+// out of the GenericFifo so that it doesn't dilute the packed fifo headers.
+struct FifoLinks
+{
+    ClockDomain *producerClockDomain; // Producer update function clock domain
+    ClockDomain *consumerClockDomain; // Consumer update function clock domain
+    FifoPending *pending;             // Delay > 0: ring of pending counts indexed by sync slot
+    FifoChannel *channel;             // Delay > 0 and cross-domain: channel to consumer
+
+    // Recorded at initialization for the fifo statistics, which can be
+    // enabled after the port wrappers have been released
+    FifoPort<byte> *port;             // Used to name the fifo
+    Component      *consumer;         // Reading component, or NULL for a trigger
+    int            minSize;           // Smallest size allowed by the fifo delay
+};
+
 /////////////////////////////////////////////////////////////////
 //
 // Fifo struct.  Allocated by clock domains in the same
 // manner as port storage.  Fifo storage is really just a
 // specialized type of port storage with a different set 
-// of accessors.
+// of accessors.  Head and tail are 32-bit byte offsets; the
+// storage of small fifos immediately follows the GenericFifo,
+// while fifos with more than CASCADE_MAX_INLINE_FIFO_SIZE bytes
+// of storage are allocated in a separate arena so that they
+// don't dilute the packed fifo headers.
 //
-/////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
 struct GenericFifo
 {
     // Deferred construction
@@ -81,19 +158,22 @@ struct GenericFifo
         bool _noflow,
         intptr_t target, 
         ClockDomain *producer,
-        ClockDomain *consumer);
+        ClockDomain *consumer,
+        byte *_data,
+        FifoLinks *_links);
 
     // Simulation
     void reset ();
     void archive (Archive &ar);
 
-    uint16 head;       // Head byte offset seen by consumer
-    uint16 tail;       // Tail byte offset seen by producer
-    uint16 freeCount;  // Count of free fifo entries seen by producer
-    uint16 fullCount;  // Non-trigger: Count of used fifo entries seen by consumer
-    uint16 size;       // Size in bytes of fifo storage.  0 for a bit-bucket or a combinational trigger
+    uint32 head;       // Head byte offset seen by consumer
+    uint32 tail;       // Tail byte offset seen by producer
+    uint32 freeCount;  // Count of free fifo entries seen by producer
+    uint32 fullCount;  // Non-trigger: Count of used fifo entries seen by consumer
+    uint32 size;       // Size in bytes of fifo storage.  0 for a bit-bucket or a combinational trigger
+    uint32 minFree;    // Used to compute fifo high water mark
+    uint32 numPushes;  // Total number of entries pushed (wraps around)
     uint16 dataSize;   // Size in bytes of a single fifo entry.
-    uint16 minFree;    // Used to compute fifo high water mark
 
     // Optimization: can replace the test (!noflow && delay) with (popDelay > 0)
     union
@@ -106,30 +186,28 @@ struct GenericFifo
         };
     };
 
-    // Make sure the size of this structure is a multiple of 64 to avoid
-    // alignment problems in 32-bit builds (Fifo::data needs to appear
-    // immediately following GenericFifo with no gap).
+    byte *data;        // Fifo storage
+
+    // Note: As an optimization, combinational triggers are stored with size = 0 and
+    //       the trigger pointer stored directly in target (without bit 0 set).
+    intptr_t target;   // ITrigger * (bit 0 set) or Component * (bit 0 clear)
+
+    // The links pointer is padded to 64 bits so that the size of this structure
+    // is a multiple of 8 bytes in 32-bit builds, which keeps inline fifo storage
+    // aligned.
     union
     {
-        uint32 unused[4];
-        struct  
-        {
-            // Note: As an optimization, combinational triggers are stored with size = 0 and
-            //       the trigger pointer stored directly in target (without bit 0 set).
-            intptr_t target;          // ITrigger * (bit 0 set) or Component * (bit 0 clear)
-            ClockDomain *producerClockDomain; // Producer update function clock domain
-            ClockDomain *consumerClockDomain; // Consumer update function clock domain    
-       };
+        FifoLinks *links;
+        uint64    linksPad;
     };
 };
 
-#define GENERIC_FIFO_DATA(fifo) ((byte*)(fifo+1))
+STATIC_ASSERT((sizeof(GenericFifo) & 7) == 0);
 
+// Typed view of a fifo
 template <typename T>
 struct Fifo : public GenericFifo
 {
-    // Data array with Fifo contents
-    T data[1];
 };
 
 // Bitbucket target
@@ -140,17 +218,11 @@ struct FifoBitbucketTarget : public ITrigger<byte>
 
 extern FifoBitbucketTarget fifoBitbucketTarget;
 
-// Various places in the code assume that there is no gap between 
-// GenericFifo and the data field.  Make sure that structure alignment
-// doesn't violate this for large types.  gcc doesn't want these assertions
-// to be static, so make them dynamic in GenericFifo::initialize()
-#ifdef _MSC_VER
-STATIC_ASSERT(offsetof(Fifo<byte>,   data) == sizeof(GenericFifo));
-STATIC_ASSERT(offsetof(Fifo<uint64>, data) == sizeof(GenericFifo));
-STATIC_ASSERT(offsetof(Fifo<u128>,   data) == sizeof(GenericFifo));
-#endif
+// Per-thread scratch entry returned by FifoPort::reserve() for fifos without storage
+byte *getFifoScratch ();
 
-#define CASCADE_MAX_FIFO_SIZE      65535
+#define CASCADE_MAX_FIFO_SIZE        0x7fffffff
+#define CASCADE_MAX_INLINE_FIFO_SIZE 65535
 #define CASCADE_MAX_FIFO_DELAY     65535
 
 /////////////////////////////////////////////////////////////////
@@ -328,45 +400,158 @@ public:
         VALIDATE_FIFO_WRITE;
         if (fifo->size)
         {
-            assert(fifo->freeCount);
-            assert(fifo->tail < fifo->size * fifo->dataSize);
-            fifo->freeCount--;
-            if (fifo->freeCount < fifo->minFree)
-                fifo->minFree = fifo->freeCount;
             *(value_t*)(((byte*)fifo->data) + fifo->tail) = data;
-            if (!fifo->tail)
-                fifo->tail = fifo->size;
-            fifo->tail -= sizeof(T);
-            if (fifo->delay)
-                fifo->consumerClockDomain->schedulePush((GenericFifo *) fifo);
-            else if (!fifo->fullCount++)
-                ((Component *) fifo->target)->activate();
+            advanceTail();
         }
         else
             ((ITrigger<value_t> *) fifo->target)->trigger(data);
     }
 
     const value_t &pop ()
+    {
+        value_t *ret = (value_t *) (((byte *) fifo->data) + fifo->head);
+        release();
+        return *ret;
+    }
+
+    inline const value_t &peek () const
+    {
+        VALIDATE_FIFO_READ;
+        assert(fifo->fullCount);
+        return *(const value_t *) (((const byte *) fifo->data) + fifo->head);
+    }
+
+    //----------------------------------
+    // In-place accessors
+    //----------------------------------
+
+    // Return the storage for the next entry so that it can be built in
+    // place; commit() then pushes it.  Only one entry can be reserved at a
+    // time.  Fifos without storage (bit-bucket and combinational trigger)
+    // reserve a per-thread scratch entry, so commit() the entry before
+    // reserving from another such fifo.
+    inline value_t &reserve ()
+    {
+        VALIDATE_FIFO_WRITE;
+        if (fifo->size)
+        {
+            assert(fifo->freeCount);
+            return *(value_t *) (((byte *) fifo->data) + fifo->tail);
+        }
+        return *(value_t *) getFifoScratch();
+    }
+
+    // Push the entry returned by reserve()
+    void commit ()
+    {
+        VALIDATE_FIFO_WRITE;
+        if (fifo->size)
+            advanceTail();
+        else
+            ((ITrigger<value_t> *) fifo->target)->trigger(*(const value_t *) getFifoScratch());
+    }
+
+    // Return the first entry without copying it; release() then pops it
+    inline const value_t &front () const
+    {
+        return peek();
+    }
+
+    // Pop the first entry without returning it
+    void release ()
     {
         VALIDATE_FIFO_READ;
         assert(fifo->fullCount);
         fifo->fullCount--;
         if (fifo->popDelay > 0)
-            fifo->consumerClockDomain->schedulePop((GenericFifo *) fifo);
+            fifo->links->consumerClockDomain->schedulePop((GenericFifo *) fifo);
         else
             fifo->freeCount++;
-        value_t *ret = (value_t *) (((byte *) fifo->data) + fifo->head);
         if (!fifo->head)
             fifo->head = fifo->size;
         fifo->head -= sizeof(value_t);
-        return *ret;
     }
 
-    inline const value_t &peek () const
+    //----------------------------------
+    // Batch accessors
+    //----------------------------------
+
+    // Push n entries.  The data is copied into the ring in at most two
+    // segments, and a fifo with delay schedules a single counted push.
+    void pushN (const value_t *data, int n)
+    {
+        VALIDATE_FIFO_WRITE;
+        if (!n)
+            return;
+        if (fifo->size)
+        {
+            assert((int) fifo->freeCount >= n);
+            fifo->freeCount -= n;
+            if (fifo->freeCount < fifo->minFree)
+                fifo->minFree = fifo->freeCount;
+            fifo->tail = copyToRing(fifo->tail, data, n);
+            fifo->numPushes += n;
+            if (fifo->delay)
+                schedulePush(n);
+            else
+            {
+                if (!fifo->fullCount)
+                    ((Component *) fifo->target)->activate();
+                fifo->fullCount += n;
+            }
+        }
+        else
+        {
+            for (int i = 0 ; i < n ; i++)
+                ((ITrigger<value_t> *) fifo->target)->trigger(data[i]);
+        }
+    }
+
+    // Pop n entries, copying them to data
+    void popN (value_t *data, int n)
     {
         VALIDATE_FIFO_READ;
-        assert(fifo->fullCount);
-        return *(const value_t *) (((const byte *) fifo->data) + fifo->head);
+        FifoSpan<value_t> span = peek(n);
+        for (int s = 0 ; s < 2 ; s++)
+        {
+            const value_t *src = span.seg[s];
+            for (int i = 0 ; i < span.len[s] ; i++)
+                *data++ = src[-i];
+        }
+        popN(n);
+    }
+
+    // Discard n entries (typically after consuming them through peek(n))
+    void popN (int n)
+    {
+        VALIDATE_FIFO_READ;
+        if (!n)
+            return;
+        assert((int) fifo->fullCount >= n);
+        fifo->fullCount -= n;
+        if (fifo->popDelay > 0)
+            fifo->links->consumerClockDomain->schedulePop((GenericFifo *) fifo, n);
+        else
+            fifo->freeCount += n;
+        int offset = (int) fifo->head - n * (int) sizeof(value_t);
+        if (offset < 0)
+            offset += fifo->size;
+        fifo->head = (uint32) offset;
+    }
+
+    // Zero-copy view of the first n entries
+    inline FifoSpan<value_t> peek (int n) const
+    {
+        VALIDATE_FIFO_READ;
+        assert((int) fifo->fullCount >= n);
+        const byte *data = (const byte *) fifo->data;
+        int first = fifo->head / sizeof(value_t) + 1;
+        FifoSpan<value_t> span;
+        span.seg[0] = (const value_t *) (data + fifo->head);
+        span.len[0] = (n < first) ? n : first;
+        span.seg[1] = (const value_t *) (data + fifo->size - sizeof(value_t));
+        span.len[1] = n - span.len[0];
+        return span;
     }
 
     inline int highWaterMark () const
@@ -374,6 +559,53 @@ public:
         return fifo->size ? (fifo->size / fifo->dataSize) - fifo->minFree : 0;
     }
 
+protected:
+
+    // Push the entry at the tail, which has already been written
+    inline void advanceTail ()
+    {
+        assert(fifo->freeCount);
+        assert(fifo->tail < fifo->size);
+        fifo->freeCount--;
+        if (fifo->freeCount < fifo->minFree)
+            fifo->minFree = fifo->freeCount;
+        if (!fifo->tail)
+            fifo->tail = fifo->size;
+        fifo->tail -= sizeof(T);
+        fifo->numPushes++;
+        if (fifo->delay)
+            schedulePush(1);
+        else if (!fifo->fullCount++)
+            ((Component *) fifo->target)->activate();
+    }
+
+    // Make n pushed entries visible to the consumer after the fifo delay
+    inline void schedulePush (int n)
+    {
+        FifoChannel *channel = fifo->links->channel;
+        if (channel)
+            descore::atomicStoreRelease(channel->pushed, (int) ((unsigned) channel->pushed + n));
+        else
+            fifo->links->consumerClockDomain->schedulePush((GenericFifo *) fifo, n);
+    }
+
+    // Copy n entries into the ring starting at byte offset tail; return the new tail
+    unsigned copyToRing (unsigned tail, const value_t *data, int n)
+    {
+        byte *ring = (byte *) fifo->data;
+        int first = tail / sizeof(value_t) + 1;
+        int len = (n < first) ? n : first;
+        value_t *dst = (value_t *) (ring + tail);
+        for (int i = 0 ; i < len ; i++)
+            dst[-i] = data[i];
+        if (len == n)
+            return (n == first) ? fifo->size - sizeof(value_t) : tail - n * sizeof(value_t);
+        dst = (value_t *) (ring + fifo->size - sizeof(value_t));
+        for (int i = len ; i < n ; i++)
+            dst[len - i] = data[i];
+        return fifo->size - (n - len + 1) * sizeof(value_t);
+    }
+
 protected:
     union
     {
@@ -57,6 +57,10 @@ struct CascadeParams
     UintParameter   (ClockRounding,         5,          
         "Rising clock edges within this many picoseconds of an even number of nanoseconds will be "
         "rounded to the even number of nanoseconds");
+    UintParameter   (ClockScheduleSize,     65536,      
+        "Maximum number of steps in the precomputed schedule of clock edges (0 to always schedule the "
+        "clock domains dynamically).  No schedule is precomputed if a clock is divided by a ratio "
+        "that isn't a/b with b < 64");
 
     // Tracing
     StringParameter (Traces,                "",         "Specify a set of traces using the same format as the -trace command-line directive");
@@ -67,7 +71,17 @@ struct CascadeParams
     StringParameter (DumpSignals,           "",         "Specify a set of signals to dump using the same format as the -dump command-line directive");
     StringParameter (WavesFilename,         "sim.vcd",  "Filename used for waves dumping");
     StringParameter (WavesTimescale,        "1 ps",     "Timescale string for VCD file");
+    Uint64Parameter (WavesStartTime,        0,          "Waves dumping is disabled before WavesStartTime (ns)");
+    Uint64Parameter (WavesStopTime,         -1,         "Waves dumping is disabled after WavesStopTime (ns)");
     UintParameter   (WavesDT,               10,         "Minimum time increment (ps) between succcessive times in the VCD file")
+    EnumParameter   (WavesFormat,           Vcd,        "Waves file format (Cwf is a compact binary format; see Waves::convertToVcd())", Vcd, Cwf);
+    BoolParameter   (WavesCompress,         false,      "Write VCD waves files with gzip compression (.gz is appended to the filename)");
+    UintParameter   (WavesBlockSize,        0x100000,   "Uncompressed size in bytes of the blocks of value changes in a cwf waves file");
+    UintParameter   (WavesCompressThreads,  2,          "Number of threads used to compress cwf waves blocks, or 0 to compress in the waves writer thread");
+    BoolParameter   (WavesWriterThread,     true,       "Format and write waves in a separate writer thread");
+    UintParameter   (WavesHistory,          0,          "If nonzero, keep the most recent WavesHistory ns of waves in memory and only write them on failure or Waves::dumpHistory()");
+    UintParameter   (WavesFifoContents,     0,          "If nonzero, dump the occupancy and ring contents of FIFOs with at most this many entries");
+    UintParameter   (WavesBufferSize,       64,         "Maximum waves data (MB) waiting for the writer thread before the simulation stalls");
 
     // Checkpointing
     UintParameter   (CheckpointInterval,    0,          "Simulated time (ns) between archive checkpoints, or 0 to disable checkpoints");
@@ -75,6 +89,7 @@ struct CascadeParams
     StringParameter (RestoreFromCheckpoint, "",         "Checkpoint file from which simulation should be restored after initialization");
     StringParameter (ValidateCheckpoint,    "",         "Secondary checkpoint file against which first checkpoint file should be validated");
     BoolParameter   (SafeCheckpoint,        false,      "Create archive checkpoints in safe mode (see descore documentation)");
+    BoolParameter   (ReplayWaves,           false,      "Regenerate the waves between WavesStartTime and WavesStopTime from the latest earlier checkpoint, then exit");
 
     // Misc
     BoolParameter   (ExactPortNames,        false,      "When binding to a Verilog port, require that the port name (appropriately translated) matches exactly");
@@ -87,6 +102,12 @@ struct CascadeParams
     UintParameter   (Finish,                0,          "If non-zero, end the simulation at the specified time (in ns)");
     BoolParameter   (FifoSizeWarnings,      true,       "Print a warning message if a fifo size is too small to sustain full throughput");
     IntParameter    (NumThreads,            1,          "Number of threads to use for simulation.  Set to -1 to use maximum number of threads.");
+    BoolParameter   (PortLocality,          false,      "Place ports that are read by the same update function next to each other in port storage (useful when ports are read in a different order than they are constructed)");
+    BoolParameter   (SkipIdleEdges,         true,       "Skip the rising clock edges of clock domains with no active components and no scheduled work");
+    BoolParameter   (CoalesceArrayTriggers, false,      "Allocate arrays of single-byte ports contiguously and coalesce their activation triggers");
+    BoolParameter   (HugePages,             false,      "Allocate port, fifo and update storage using huge pages (Linux only)");
+    BoolParameter   (FifoStats,             false,      "Collect per-fifo occupancy and stall statistics (see Sim::dumpFifoStats()); can be enabled at any time");
+    StringParameter (FifoSizes,             "",         "Fifo sizing report (see Sim::writeFifoSizingReport()) whose suggested sizes replace the constructed fifo sizes");
 };
 
 // Defined in SimGlobals.cpp
@@ -69,6 +69,10 @@ public:
     void initPorts (ClockDomain *domain);
     void initFifos (ClockDomain *domain);
 
+    // Allocate the pending push/pop rings of fifos with delay, and the
+    // channels of the ones that are pushed from another clock domain
+    void initDelayedFifos (int syncDepth);
+
     // Resolve the src and dst pointers of all value copies after ports have been
     // initialized in all clock domains.
     void finalizeCopies ();
@@ -99,11 +103,19 @@ public:
     // Archive the ports
     void archive (Archive &ar);
     void archvieFifos (Archive &ar);
-    void archiveFifoStack (Archive &ar, stack<GenericFifo *> &v);
+    void archiveFifoStack (Archive &ar, stack<GenericFifo *> &v, int slot);
 
     // Check for a non-empty fifo with a deactivated consumer
     void checkDeadlock ();
 
+    // Fifo statistics (cascade.FifoStats).  sampleFifoStarvation() is called
+    // before the updates of each cycle, sampleFifoStats() after them.
+    void initFifoStats ();
+    void sampleFifoStarvation ();
+    void sampleFifoStats ();
+    void resetFifoStats ();
+    void getFifoStats (std::vector<FifoStats> &stats) const;
+
 private:
     typedef std::map<uint32, PortList> PortMap;
 
@@ -111,6 +123,12 @@ private:
     // of bytes used/required.
     int allocateValues (const PortMap &ports, int *depthOffset, int *nsize = NULL, byte *storage = NULL);
 
+    // Helper functions for placing ports read by the same update function together
+    typedef std::map<const PortWrapper *, int, descore::allow_ptr<const PortWrapper *> > ReaderMap;
+    void getFirstReaders (ReaderMap &firstReader) const;
+    static void updateFirstReader (ReaderMap &firstReader, const PortWrapper *terminal, const PortWrapper *p);
+    static void sortByReader (PortList &ports, const ReaderMap &firstReader);
+
 private:
     //----------------------------------
     // Initialization
@@ -143,6 +161,28 @@ private:
     byte *m_fifoData;
     int   m_numFifos;
     int   m_fifoDataSize;
+    byte  *m_largeFifoData;    // Storage of fifos larger than CASCADE_MAX_INLINE_FIFO_SIZE
+    int64 m_largeFifoDataSize;
+    FifoLinks   *m_fifoLinks;   // Clock domains, pending ring and channel of each fifo
+    FifoPending *m_fifoPending; // Pending push/pop rings for fifos with delay
+    byte        *m_channelData; // Storage for m_fifoChannels (unaligned)
+    FifoChannel *m_fifoChannels;    // Channels of cross-domain fifos with delay
+    int         m_numFifoChannels;
+
+    // Statistics of the fifos with storage (cascade.FifoStats)
+    struct FifoStatsEntry
+    {
+        GenericFifo    *fifo;
+        FifoPort<byte> *port;          // Used to name the fifo
+        Component      *consumer;      // Reading component, or NULL for a trigger
+        int            minSize;        // Smallest size allowed by the fifo delay
+        uint32         numPushes;      // fifo->numPushes at the previous sample
+        uint32         updatePushes;   // fifo->numPushes before the updates
+        bool           emptyAtUpdate;  // Fifo was empty before the updates
+        FifoStats      stats;
+    };
+    FifoStatsEntry *m_fifoStats;
+    int            m_numFifoStats;
 
     //----------------------------------
     // Port/register storage
@@ -256,7 +256,17 @@ public:
     uint16 verilog_wr  : 1;  // True if this port is written from a Verilog binding
     uint16 verilog_rd  : 1;  // True if this port is read by a Verilog binding 
 
-    uint16 fifoSize; // Capacity of fifo (FIFO ports only)
+    // Elements of single-byte port arrays are marked for trigger coalescing when 
+    // cascade.CoalesceArrayTriggers is set.  Such arrays are allocated contiguously
+    // in their own storage block, and runs of their ports with identical activation
+    // triggers that are written by the same update function are coalesced into a 
+    // single multi-byte trigger (coalesceRun is the length of the run starting at
+    // this port).
+    uint16 coalesce    : 1;
+    uint16 coalesceRun;
+
+    uint32 fifoSize; // Capacity of fifo (FIFO ports only)
+    uint32 fifoMinSize; // Smallest capacity allowed by the fifo delay (FIFO ports only)
 
     // Delay of FIFO or synchronous connection.  Also used within port storage 
     // initialization for non-synchronous ports to indicate maximum delay of any 
@@ -76,12 +76,15 @@ struct CascadeStats
     int64 numUpdateBytes;
     int64 numRegisterBytes;
     int64 numFakeRegisterBytes;
+    int64 numHugePageBytes;
 
     // Activation stats
     int64 numActiveUpdates;
     int64 numUpdatesProcessed;
     int64 numActivations;
     int64 numDeactivations;
+    int64 numIdleEdges;
+    int64 numSkippedEdges;
 
     // Performance stats
     uint64 preTickTime;
@@ -90,6 +93,37 @@ struct CascadeStats
     uint64 updateTime;
 };
 
+////////////////////////////////////////////////////////////////////////
+//
+// FifoStats
+//
+// Occupancy and stall statistics of a single fifo, sampled on every
+// rising edge of the consumer clock domain when cascade.FifoStats is set.
+// Occupancy is seen by the producer, so it includes entries and credits
+// that are still in flight.
+//
+////////////////////////////////////////////////////////////////////////
+#define FIFO_STATS_BUCKETS 9
+
+struct FifoStats
+{
+    string name;              // Name of the fifo port that is pushed
+    int    capacity;          // Fifo size in entries
+    int64  cycles;            // Number of consumer clock cycles sampled
+    int64  pushes;            // Number of entries pushed
+    int64  fullCycles;        // Cycles on which the fifo was full (producer stalled)
+    int64  starvedCycles;     // Cycles on which no entries were available to the consumer
+    int64  occupancySum;      // Sum of the sampled occupancies
+    int    maxOccupancy;      // Maximum sampled occupancy
+    int    highWaterMark;     // Peak occupancy since the last reset, including within a cycle
+    int    minSize;           // Smallest size allowed by the fifo delay
+
+    // Occupancy histogram.  Bucket 0 counts the cycles on which the fifo was
+    // empty; bucket i > 0 counts the cycles on which the occupancy was in
+    // the range ((i-1)/8, i/8] of the capacity.
+    int64  histogram[FIFO_STATS_BUCKETS];
+};
+
 ////////////////////////////////////////////////////////////////////////
 //
 // Sim
@@ -183,6 +217,20 @@ public:
     static void dumpSignals (const Component *c, int level = 0);
     static void dumpSignals (const Component *c, const char *wcSignals, int level = 0);
 
+    // Fifo statistics (requires cascade.FifoStats).  getFifoStats() returns the
+    // statistics of every fifo with storage; dumpFifoStats() logs them as a table
+    // sorted by the number of full cycles, limited to maxFifos rows if non-zero.
+    // resetFifoStats() also restarts the fifo high water marks.
+    static void getFifoStats (std::vector<FifoStats> &stats);
+    static void dumpFifoStats (int maxFifos = 0);
+    static void resetFifoStats ();
+
+    // Write a fifo sizing report (requires cascade.FifoStats).  For each fifo the
+    // report gives the current size and the smallest size that would not have
+    // introduced additional stalls in this run.  Set cascade.FifoSizes to the
+    // report filename to apply the suggested sizes.
+    static void writeFifoSizingReport (const char *filename);
+
 private:
     // Called from component destructors to clean things up.
     static void cleanupInternal ();
@@ -0,0 +1,65 @@
+/*
+Copyright 2007, D. E. Shaw Research.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+* Redistributions of source code must retain the above copyright
+  notice, this list of conditions, and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions, and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+* Neither the name of D. E. Shaw Research nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+//////////////////////////////////////////////////////////////////////
+//
+// SimMemory.hpp
+//
+// Copyright (C) 2026 D. E. Shaw Research
+//
+// Created: 10/18/2026
+//
+// Allocation of the large arenas that hold the simulation state
+// (port data, fifo data and update arrays).  These arenas are accessed
+// randomly on every clock edge, so when cascade.HugePages is set they
+// are backed by huge pages to reduce TLB misses.  On platforms that
+// do not support huge pages the allocation falls back to new[].
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef SimMemory_hpp_261018093512
+#define SimMemory_hpp_261018093512
+
+BEGIN_NAMESPACE_CASCADE
+
+// Allocate/free a block of simulation state.  The size passed to
+// freeSimMemory() must match the size passed to allocSimMemory().
+byte *allocSimMemory (int64 size);
+void freeSimMemory (byte *data, int64 size);
+
+// Return the number of bytes of simulation state currently backed
+// by huge pages.
+int64 getHugePageBytes ();
+
+END_NAMESPACE_CASCADE
+
+#endif // #ifndef SimMemory_hpp_261018093512
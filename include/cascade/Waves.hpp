@@ -65,6 +65,18 @@ struct Waves
     static void dumpSignals (const char *wcComponent, const char *wcSignals, int level);
     static void dumpSignals (const Component *component, const char *wcSignals, int level);
 
+    // Enable or disable dumping at run time.  Only signals that were declared 
+    // for dumping before Sim::init() can be enabled; disabled signals are 
+    // written as undefined and are not examined by the clock domains.  Dumping 
+    // is also disabled outside of [cascade.WavesStartTime, cascade.WavesStopTime].
+    // These functions can be called from component code (e.g. from a port 
+    // trigger); changes take effect when the current time step is dumped.
+    static void setDumping (bool enable);
+    static void setDumping (const char *wcComponent, const char *wcSignals, bool enable);
+
+    // True if dumping is currently enabled
+    static bool enabled;
+
     //----------------------------------
     // Internal helper functions
     //----------------------------------
@@ -79,6 +91,30 @@ struct Waves
     // Refresh signal state following an archive load
     static void archive ();
 
+    // Apply the dumping window and any pending setDumping() requests (called
+    // before each time step is dumped)
+    static void updateDumping ();
+
+    // Advance the time step number that orders the value changes.  Called at 
+    // the start and end of each call to tickDomains(), including the calls
+    // nested in manual clock ticks.
+    static void nextStep ();
+
+    // Pass the value changes of the current time step to the waves writer
+    static void flush ();
+
+    // When cascade.WavesHistory is nonzero, value changes are kept in memory
+    // and only the most recent WavesHistory ns are written to the waves file,
+    // either when dumpHistory() is called or when the simulation fails.  If
+    // closeFile is true then the waves file is completed and closed.
+    static void dumpHistory (bool closeFile = false);
+
+    // Convert a cwf waves file (cascade.WavesFormat = Cwf) to VCD.  If a time
+    // window is specified (in the time units of the waves file), then only
+    // the blocks of the cwf file that overlap the window are read.
+    static void convertToVcd (const char *cwfFilename, const char *vcdFilename, 
+                              uint64 startTime = 0, uint64 endTime = uint64(-1));
+
     //----------------------------------
     // These are static member functions for various friend access
     //----------------------------------
@@ -108,7 +144,21 @@ public:
     void open (const char *filename);
     void close ();
 
+    // Value changes are buffered per simulation thread.  flush() is called by
+    // the main thread once the simulation threads are idle; it passes the
+    // buffered changes to the writer thread (cascade.WavesWriterThread), which 
+    // orders them by time step and signal id and writes them to the file.  The
+    // time steps are numbered by nextStep() rather than ordered by simulation
+    // time, which can go backwards when manual clock domains are ticked.
+    // drain() waits for the writer thread to finish, and must be called before
+    // the subclass is destroyed.
+    void nextStep ();
     void valueChange (uint32 id, const byte *value, bool undefined, int sizeInBits);
+    void flush ();
+    void drain ();
+
+    // Write the in-memory history (cascade.WavesHistory) to the file
+    void dumpHistory ();
 
     //----------------------------------
     // Specialized functions
@@ -120,6 +170,11 @@ public:
         return "w";
     }
     virtual void beginFile () = 0;
+    virtual void endFile () {}
+    virtual void flushFile ()
+    {
+        fflush(m_file);
+    }
 
     // Define signals
     virtual void beginComponent (const char *name) = 0;
@@ -136,15 +191,131 @@ protected:
     uint64 m_currTime;
     uint64 m_currSimTime;
     descore::SpinLock m_lock;
+
+private:
+    // Buffered value changes.  Each change is a Record followed by the value
+    // padded to a multiple of 8 bytes.
+    struct Record
+    {
+        uint64 simTime;
+        uint32 step;       // Time step number (see nextStep())
+        uint32 id;
+        int    sizeInBits;
+        bool   undefined;
+    };
+    struct Buffer
+    {
+        byte *data;
+        int   size;
+        int   capacity;
+    };
+    struct Batch
+    {
+        std::vector<Buffer> buffers;
+        int bytes;
+    };
+
+    // Flight recorder state (cascade.WavesHistory).  Each history block is a
+    // compacted copy of one thread buffer.  Blocks that fall out of the history 
+    // window are folded into m_historyValues, which holds the most recent value
+    // of every signal at the start of the window.
+    struct HistoryBlock
+    {
+        Buffer buffer;
+        uint64 simTime;
+    };
+    struct HistoryValue
+    {
+        HistoryValue () : sizeInBits(0), undefined(false) {}
+
+        int               sizeInBits; // 0 if the signal has no value yet
+        bool              undefined;
+        std::vector<byte> value;
+    };
+
+    static int recordSize (const Record *record);
+    static bool recordLess (const void *a, const void *b);
+    Buffer *getThreadBuffer ();
+    void writeBatch (Batch *batch);
+    void writerThread ();
+    void recordHistory (const Buffer &buffer);
+    void applyHistory (const Buffer &buffer);
+
+    volatile int          m_step;          // Current time step number
+    uint32                m_generation;    // Distinguishes this file in the thread-local buffer pointers
+    std::vector<Buffer *> m_threadBuffers; // One buffer per simulation thread
+    descore::SpinLock     m_bufferLock;    // Protects m_threadBuffers
+    std::vector<Batch *>  m_batches;       // Batches waiting for the writer thread
+    std::vector<byte *>   m_freeData;      // Recycled buffer storage
+    descore::SpinLock     m_batchLock;     // Protects m_batches and m_freeData
+    volatile int          m_pendingBytes;  // Size of the batches waiting for the writer thread
+    volatile bool         m_exitWriter;
+    descore::Thread      *m_writer;
+    static uint32         s_nextGeneration;
+
+    std::deque<HistoryBlock>  m_history;
+    std::vector<HistoryValue> m_historyValues;
 };
 
 // VCD implementation
 class VcdWavesFile : public WavesFile
 {
 public:
-    VcdWavesFile () : m_nextId(33) {}
+    VcdWavesFile ();
     ~VcdWavesFile ();
+    const char *fmode () const
+    {
+        return params.WavesCompress ? "wb" : "w";
+    }
+    void beginFile ();
+    void endFile ();
+    void flushFile ();
+
+    // Define signals
+    void beginComponent (const char *name);
+    uint32 addSignal (const char *name, int sizeInBits); // returns UID
+    void endComponent ();
+    void endSignals ();
+
+    // Add value change events
+    void dumpTime (uint64 time);
+    void dumpValue (uint32 id, const byte *value, bool undefined, int sizeInBits);
+
+private:
+    // The formatted text is collected in m_buffer and written in large 
+    // blocks, either directly or through a gzip stream (cascade.WavesCompress)
+    inline void reserve (int bytes)
+    {
+        if (m_size + bytes > m_capacity)
+            writeBuffer(0);
+    }
+    void put (const char *text);
+    void writeBuffer (int flush);
+
+    uint32 m_nextId;
+    char   *m_buffer;
+    int    m_size;
+    int    m_capacity;
+    void   *m_stream; // z_stream when compressing
+    std::vector<byte> m_compressed;
+};
+
+// Compact binary implementation.  A cwf file consists of a header, a 
+// compressed block containing the signal hierarchy, a sequence of 
+// self-contained compressed blocks of value changes, and an index of the
+// value change blocks.  The blocks are compressed by a pool of threads
+// (cascade.WavesCompressThreads).  See CwfWavesFile.cpp for the format.
+class CwfWavesFile : public WavesFile
+{
+public:
+    CwfWavesFile ();
+    ~CwfWavesFile ();
+    const char *fmode () const
+    {
+        return "wb";
+    }
     void beginFile ();
+    void endFile ();
 
     // Define signals
     void beginComponent (const char *name);
@@ -157,7 +328,67 @@ public:
     void dumpValue (uint32 id, const byte *value, bool undefined, int sizeInBits);
 
 private:
+    inline void reserve (int bytes)
+    {
+        if (m_size + bytes > m_capacity)
+            grow(bytes);
+    }
+    void grow (int bytes);
+    void putVarint (uint64 val);
+    void putString (const char *str);
+    void writeBlock (byte type);
+    void writeSnapshot ();
+
+    struct BlockIndex
+    {
+        uint64 startTime;
+        uint64 endTime;
+        uint64 offset;
+    };
+
+    // Block waiting to be compressed and written
+    struct PendingBlock
+    {
+        byte              type;
+        uint64            startTime;
+        uint64            endTime;
+        std::vector<byte> data;
+        std::vector<byte> compressed;
+        volatile int      state; // One of BlockState
+    };
+    enum BlockState
+    {
+        BlockQueued,
+        BlockCompressing,
+        BlockCompressed
+    };
+    static void compressBlock (PendingBlock *block);
+    void writeCompressedBlock (const PendingBlock *block);
+    void writePendingBlocks (bool wait);
+    void compressorThread ();
+    void stopCompressors ();
+
+    byte  *m_data;       // Uncompressed contents of the current block
+    int    m_size;
+    int    m_capacity;
     uint32 m_nextId;
+    uint64 m_blockStart; // Time at the start of the current block
+    uint64 m_lastTime;   // Most recent time written to the current block
+    uint64 m_offset;     // Number of bytes written to the file
+    std::vector<BlockIndex> m_index;
+
+    // Current value of every signal, used to start each block with a snapshot
+    std::vector<int>    m_sizes;       // Signal size in bits, indexed by id
+    std::vector<uint32> m_valueOffset; // Offset of the signal value in m_values
+    std::vector<byte>   m_values;
+    std::vector<byte>   m_valueState;  // 0 = no value yet, 1 = defined, 2 = undefined
+    uint32              m_numValues;   // Number of signals with a value
+
+    // Compression threads
+    std::deque<PendingBlock *>     m_pending;
+    descore::SpinLock              m_pendingLock;
+    std::vector<descore::Thread *> m_compressors;
+    volatile bool                  m_exitCompressors;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -193,6 +424,7 @@ class WavesSignal : public IWavesFunctions
 {
     friend struct WavesComponent;
     friend class WavesFifo;
+    friend class WavesSnapshot;
 public:
     // Signal types
     enum SignalType
@@ -223,6 +455,9 @@ public:
     // Dump the signal at run time (called from WaveComponent)
     void dump ();
 
+    // Write the signal as undefined when dumping is disabled
+    void dumpOff ();
+
     // Linked lists
     WavesSignal *next;
 
@@ -237,10 +472,49 @@ private:
     byte   m_validValue; // validValue for a debug build port with a value flag, or 0
     byte   m_currValid;  // Most recent observed valid flag
     byte   m_type;       // One of SignalType
+    bool   m_enabled;    // Set by Waves::setDumping()
     uint32 m_id;         // Signal UID
     int    m_index;      // Signal index within parent component
 };
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Change detection for a list of dumped signals.  The raw port data of the
+// signals is mirrored in a contiguous shadow array, and only the signals 
+// whose port data differs from the shadow are converted and dumped.
+//
+////////////////////////////////////////////////////////////////////////////////
+class WavesSnapshot
+{
+    friend class WavesFifo;
+public:
+    WavesSnapshot (WavesSignal *signals);
+
+    // Dump the signals that have changed since the previous call
+    void dump ();
+
+    // Rebuild the snapshots and dump every enabled signal on the next call 
+    // (e.g. after restoring a checkpoint, since the waves file is restarted)
+    static void invalidate ();
+
+private:
+    struct Entry
+    {
+        const byte  *data;   // Port data, including the debug valid flag
+        WavesSignal *signal;
+        uint32      offset;  // Byte offset into m_shadow
+        uint32      size;    // Size of the port data
+    };
+
+    void build ();
+
+    WavesSignal        *m_signals;
+    std::vector<Entry> m_entries;
+    std::vector<byte>  m_shadow;
+    uint32             m_epoch;
+    static uint32      s_epoch;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Support for FIFO ports
@@ -267,6 +541,7 @@ public:
     WavesSignal dataSignal;
     WavesSignal validSignal;
     WavesSignal creditSignal;
+    WavesSignal countSignal;
     WavesFifo   *next;
 
     // Update state & dump
@@ -274,6 +549,12 @@ public:
     void update ();
 
 private:
+    // Occupancy and ring contents (params.WavesFifoContents)
+    void addContents ();
+    void resetContents ();
+    void dumpContents ();
+    void dumpSlot (uint32 offset);
+
     bit    m_valid;
     bit    m_credit;
 
@@ -286,10 +567,20 @@ private:
     //   Consumer.credit: set when head has changed following update()
     //   Producer.credit: delay = 0: set when head has changed following update()
     //                    delay < 0: set when freeCount has changed following tick()
-    uint16 m_head;  
-    uint16 m_tail;  
-    uint16 m_freeCount;
-    uint16 m_fullCount;
+    uint32 m_head;  
+    uint32 m_tail;  
+    uint32 m_freeCount;
+    uint32 m_fullCount;
+
+    // Ring contents.  One signal is dumped per ring slot, and only the slots 
+    // that were pushed or freed since the previous update are visited.  The
+    // occupied slots are the m_count slots starting at m_contentsHead, where
+    // the occupancy counts entries that have not yet returned their credit.
+    std::vector<WavesSignal *> m_slots;
+    uint32 m_count;         // Number of occupied slots
+    uint32 m_contentsHead;  // Byte offset of the oldest occupied slot
+    uint32 m_numPushes;     // Value of fifo->numPushes at the previous update
+    uint32 m_contentsEpoch; // WavesSnapshot epoch of the previous update
 
     union
     {
@@ -327,6 +618,10 @@ struct WavesComponent
     void doAcross (wavefunc f);
     void cleanup ();
 
+    // Runtime dumping control; 'path' is the hierarchical name of this component
+    void setDumping (const string &path, const char *wcComponent, const char *wcSignals, bool enable);
+    void dumpOff ();
+
     typedef std::map<string, WavesComponent *> ComponentMap;
     typedef std::map<string, WavesSignal *> SignalMap;
 
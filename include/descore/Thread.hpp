@@ -51,6 +51,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ThreadFunction.hpp"
 #include "Iterators.hpp"
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 BEGIN_NAMESPACE_DESCORE
 
 class Tracer;
@@ -184,6 +188,30 @@ int atomicIncrement (volatile int &value);
 // Decrement an integer and return the new value
 int atomicDecrement (volatile int &value);
 
+// Store an integer with release semantics (all prior writes are visible to
+// a thread that observes the new value through atomicLoadAcquire())
+inline void atomicStoreRelease (volatile int &dest, int value)
+{
+#ifdef _MSC_VER
+    _ReadWriteBarrier();
+    dest = value;
+#else
+    __atomic_store_n(&dest, value, __ATOMIC_RELEASE);
+#endif
+}
+
+// Load an integer with acquire semantics
+inline int atomicLoadAcquire (const volatile int &src)
+{
+#ifdef _MSC_VER
+    int value = src;
+    _ReadWriteBarrier();
+    return value;
+#else
+    return __atomic_load_n(&src, __ATOMIC_ACQUIRE);
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Mutex
@@ -43,6 +43,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "stdafx.h"
 #include "Cascade.hpp"
+#include "SimMemory.hpp"
 #include <descore/MapIterators.hpp>
 #include <descore/Thread.hpp>
 
@@ -66,9 +67,20 @@ ClockDomain *ClockDomain::s_firstManual = NULL;
 int ClockDomain::s_numClockDomains = 0;
 time_t ClockDomain::s_lastDeadlockCheckTime = 0;
 ClockDomain *ClockDomain::s_defaultClockDomain = NULL;
+TimedEventQueue ClockDomain::s_timedEvents;
+int ClockDomain::s_numScheduledDomains = 0;
+int ClockDomain::s_numIdleDomains = 0;
+int64 ClockDomain::s_idleEpoch = 1;
+std::vector<ClockDomain::ScheduleStep> ClockDomain::s_schedule;
+std::vector<ClockDomain::ScheduleLink> ClockDomain::s_scheduleLinks;
+ClockDomain::ScheduleState ClockDomain::s_scheduleState = ClockDomain::ScheduleNone;
+int ClockDomain::s_scheduleIndex = 0;
+int64 ClockDomain::s_scheduleBase = 0;
+int64 ClockDomain::s_schedulePeriod = 0;
 __thread ClockDomain *t_currentClockDomain = NULL;
 __thread const S_Update *t_currentUpdate = NULL;
 Cascade::WavesSignal *ClockDomain::s_globalWaves = NULL;
+Cascade::WavesSnapshot *ClockDomain::s_globalWavesSnapshot = NULL;
 
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -88,6 +100,31 @@ static uint64 getTimer ()
     return ret;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// isZero()
+//
+// Test a multi-byte trigger value one word at a time.  The value is not
+// necessarily aligned, so words are read using memcpy.
+//
+////////////////////////////////////////////////////////////////////////////////
+static inline bool isZero (const byte *value, unsigned size)
+{
+    for ( ; size >= sizeof(uint64) ; size -= sizeof(uint64), value += sizeof(uint64))
+    {
+        uint64 word;
+        memcpy(&word, value, sizeof(uint64));
+        if (word)
+            return false;
+    }
+    for ( ; size ; size--, value++)
+    {
+        if (*value)
+            return false;
+    }
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Threading
@@ -249,6 +286,8 @@ void runThreaded (ClockDomain *domains, void (ClockDomain::*func) ())
     if (g_error)
     {
         cleanupThreads();
+        if (params.WavesHistory)
+            Waves::dumpHistory();
         g_error->rethrow();
     }
     runningThreaded = false;
@@ -290,8 +329,16 @@ void ClockDomain::cleanupClockDomains ()
     }
 
     s_numClockDomains = 0;
+    s_numScheduledDomains = 0;
+    s_numIdleDomains = 0;
     s_defaultClockDomain = NULL;
     s_globalWaves = NULL;
+    delete s_globalWavesSnapshot;
+    s_globalWavesSnapshot = NULL;
+    s_timedEvents.clear();
+    s_schedule.clear();
+    s_scheduleLinks.clear();
+    s_scheduleState = ScheduleNone;
 
     // Clean up the threads
     cleanupThreads();
@@ -336,19 +383,30 @@ void ClockDomain::initialize (bool manual)
     m_updates = NULL;
     m_updateSize = 0;
     m_syncTriggers = NULL;
-    m_syncFifoPush = NULL;
-    m_syncFifoPop = NULL;
+    m_syncFifos = NULL;
     m_syncIndex = 0;
     m_syncDepth = 0;
     m_updateWrappers = NULL;
     m_dividedClock = NULL;
     m_generator = NULL;
+    m_gen_a = 0;
+    m_gen_b = 0;
+    m_gen_m = 0;
+    m_gen_k = 0;
     m_clockRatio = 1.0f;
     m_resolvedPeriod = false;
+    m_canSkipEdges = false;
+    m_externalRegs = false;
+    m_quiet = false;
+    m_quietEdges = 0;
+    m_skipEdge = false;
+    m_idleEpoch = 0;
     m_waveSignals = NULL;
     m_waveRegQs = NULL;
     m_waveClocks = NULL;
     m_waveFifos = NULL;
+    m_waveSnapshot = NULL;
+    m_waveRegQSnapshot = NULL;
 
     Sim::updateChecksum("ClockDomain", m_period);
     if (manual)
@@ -372,10 +430,11 @@ void ClockDomain::initialize (bool manual)
 ////////////////////////////////////////////////////////////////////////
 ClockDomain::~ClockDomain ()
 {
-    delete[] m_updates;
+    freeSimMemory(m_updates, m_updateSize);
     delete[] m_syncTriggers;
-    delete[] m_syncFifoPush;
-    delete[] m_syncFifoPop;
+    delete[] m_syncFifos;
+    delete m_waveSnapshot;
+    delete m_waveRegQSnapshot;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -436,7 +495,7 @@ ClockDomain *ClockDomain::getDefaultClockDomain ()
 ////////////////////////////////////////////////////////////////////////////////
 void ClockDomain::preTick ()
 {
-    if (m_numEdges & 1) 
+    if ((m_numEdges & 1) && (!m_skipEdge || m_externalRegs))
         m_ports.preTick();
 }
 
@@ -449,15 +508,26 @@ void ClockDomain::tick ()
 {
     if (!(m_numEdges & 1))
         return;
+    if (m_skipEdge)
+    {
+        if (m_externalRegs)
+            m_ports.tick();
+        return;
+    }
 
     int i;
 
     // Tick components
+    bool quiet = true;
     for (i = 0 ; i < m_tickableComponents.size() ; i++)
     {
         if (m_tickableComponents[i]->m_componentActive)
+        {
+            quiet = false;
             m_tickableComponents[i]->doTick();
+        }
     }
+    m_quiet = quiet;
 
     // Tick registers
     m_ports.tick();
@@ -472,44 +542,71 @@ void ClockDomain::postTick ()
 {
     if (!(m_numEdges & 1))
         return;
+    if (m_skipEdge)
+    {
+        skipEdge();
+        return;
+    }
 
     int i;
 
+    // Sample the fifo statistics following the updates of the previous cycle.
+    // The statistics can be enabled at runtime, so set them up on first use.
+    if (params.FifoStats)
+    {
+        if (!m_ports.m_fifoStats)
+            m_ports.initFifoStats();
+        m_ports.sampleFifoStats();
+    }
+
     // Invalidate N ports and zero pulse ports
     m_ports.postTick();
 
     // Scheduled trigger/fifo events
     if (m_syncDepth)
     {
+        // Schedule the pushes made from other clock domains since the last edge
+        receiveFifoPushes();
+
         m_syncIndex = (m_syncIndex + 1) & m_syncMask;
 
-        // Fifo push
-        stack<GenericFifo *> &pushes = m_syncFifoPush[m_syncIndex];
-        for (i = 0 ; i < pushes.size() ; i++)
+        // Fifo push/pop
+        stack<GenericFifo *> &fifos = m_syncFifos[m_syncIndex];
+        if (fifos.size())
+            m_quiet = false;
+        for (i = 0 ; i < fifos.size() ; i++)
         {
-            GenericFifo *fifo = pushes[i];
-            if (fifo->target & TRIGGER_ITRIGGER)
+            GenericFifo *fifo = fifos[i];
+            FifoPending &pending = fifo->links->pending[m_syncIndex];
+            if (pending.push)
             {
-                GenericTrigger *target = (GenericTrigger*) ((fifo->target) - TRIGGER_ITRIGGER);
-                const byte *data = GENERIC_FIFO_DATA(fifo) + fifo->head;
-                target->trigger(*data);
-
-                // Automatically pop the data from the fifo
-                if (!fifo->head)
-                    fifo->head = fifo->size;
-                fifo->head -= fifo->dataSize;
-                fifo->freeCount++;
+                if (fifo->target & TRIGGER_ITRIGGER)
+                {
+                    GenericTrigger *target = (GenericTrigger*) ((fifo->target) - TRIGGER_ITRIGGER);
+                    for (int count = pending.push ; count ; count--)
+                    {
+                        const byte *data = fifo->data + fifo->head;
+                        target->trigger(*data);
+
+                        // Automatically pop the data from the fifo
+                        if (!fifo->head)
+                            fifo->head = fifo->size;
+                        fifo->head -= fifo->dataSize;
+                        fifo->freeCount++;
+                    }
+                }
+                else
+                {
+                    if (!fifo->fullCount)
+                        ((Component *) fifo->target)->activate();
+                    fifo->fullCount += pending.push;
+                }
             }
-            else if (!fifo->fullCount++)
-                ((Component *) fifo->target)->activate();
+            fifo->freeCount += pending.pop;
+            pending.push = 0;
+            pending.pop = 0;
         }
-        pushes.clear();
-
-        // Fifo pop
-        stack<GenericFifo *> &pops = m_syncFifoPop[m_syncIndex];
-        for (i = 0 ; i < pops.size() ; i++)
-            pops[i]->freeCount++;
-        pops.clear();
+        fifos.clear();
 
         // Synchronous triggers
         TriggerStack &triggers = m_syncTriggers[m_syncIndex];
@@ -534,15 +631,172 @@ void ClockDomain::postTick ()
     }
 }
 
+/////////////////////////////////////////////////////////////////
+//
+// isIdle()
+//
+// Determine whether the coming rising edge can be skipped.  The
+// previous rising edges must not have run any component code for
+// long enough that the register delay chains have been shifted
+// through and the pulse ports zeroed, and nothing can be active or
+// scheduled for this edge.  Component activation is a bit in each 
+// component, so the components are scanned; this stops at the first
+// active component.
+//
+/////////////////////////////////////////////////////////////////
+bool ClockDomain::isIdle ()
+{
+    if (!m_canSkipEdges || params.FifoStats || m_verilogClocks.size())
+        return false;
+    if (m_waveSignals || m_waveRegQs || m_waveClocks || m_waveFifos || s_globalWaves)
+        return false;
+
+    // The sticky triggers always contain the end sentinel
+    if ((m_stickyTriggers.size() > 1) || m_events.isDue(m_numTicks + 1))
+        return false;
+    if (!isDrained())
+        return false;
+
+    int i;
+    for (i = 0 ; i < m_tickableComponents.size() ; i++)
+    {
+        if (m_tickableComponents[i]->m_componentActive)
+            return false;
+    }
+    for (i = 0 ; i < m_updateComponents.size() ; i++)
+    {
+        if (m_updateComponents[i]->m_componentActive)
+            return false;
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// isDrained()
+//
+// Determine whether the register delay chains and the sync rings
+// have drained, so that skipping edges can't lose a value that is
+// still in flight.  Each quiet rising edge shifts the delay chains
+// by one, so the chains have drained once the number of consecutive
+// quiet edges reaches the maximum register delay.
+//
+/////////////////////////////////////////////////////////////////
+bool ClockDomain::isDrained ()
+{
+    if (m_quietEdges < std::max(std::max(m_ports.m_maxDelay, m_syncDepth), 1))
+        return false;
+
+    int i;
+    for (i = 0 ; i < m_syncDepth ; i++)
+    {
+        if (m_syncFifos[i].size() || m_syncTriggers[i].size())
+            return false;
+    }
+    for (i = 0 ; i < m_ports.m_numFifoChannels ; i++)
+    {
+        FifoChannel &channel = m_ports.m_fifoChannels[i];
+        if (descore::atomicLoadAcquire(channel.pushed) != channel.received)
+            return false;
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// skipEdge()
+//
+// Perform the bookkeeping of a skipped rising edge
+//
+/////////////////////////////////////////////////////////////////
+void ClockDomain::skipEdge ()
+{
+    if (m_syncDepth)
+        m_syncIndex = (m_syncIndex + 1) & m_syncMask;
+    if (m_numTicks++)
+    {
+        m_prevTick = m_nextEdge;
+        m_prevIndex++;
+    }
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// tickSkippedRegisters()
+//
+// Copy and shift the registers of the domains in runList that are
+// skipping a rising edge but have registers fed from outside the
+// domain.  As on a full edge, every patched copy is made before any
+// delay chain is shifted.
+//
+/////////////////////////////////////////////////////////////////
+void ClockDomain::tickSkippedRegisters (ClockDomain *runList)
+{
+    ClockDomain *c;
+    for (c = runList ; c ; c = c->m_nextSameTick)
+    {
+        if ((c->m_numEdges & 1) && c->m_externalRegs)
+            c->m_ports.preTick();
+    }
+    for (c = runList ; c ; c = c->m_nextSameTick)
+    {
+        if ((c->m_numEdges & 1) && c->m_externalRegs)
+            c->m_ports.tick();
+    }
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// wakeDomains()
+//
+// Called when code outside of the clock domains may have modified
+// ports (timed events, or the caller of runSimulation()), so that 
+// the next rising edge of every domain is simulated in full.
+//
+/////////////////////////////////////////////////////////////////
+void ClockDomain::wakeDomains ()
+{
+    doAcross(&ClockDomain::wakeDomain);
+    s_idleEpoch++;
+    s_numIdleDomains = 0;
+}
+
+void ClockDomain::wakeDomain ()
+{
+    m_quietEdges = 0;
+}
+
 /////////////////////////////////////////////////////////////////
 //
 // schedulePush()
 //
 /////////////////////////////////////////////////////////////////
-void ClockDomain::schedulePush (GenericFifo *fifo)
+void ClockDomain::schedulePush (GenericFifo *fifo, int count)
 {
     int index = (m_syncIndex + fifo->delay) & m_syncMask;
-    m_syncFifoPush[index].push(fifo);
+    FifoPending &pending = fifo->links->pending[index];
+    if (!(pending.push | pending.pop))
+        m_syncFifos[index].push(fifo);
+    pending.push += count;
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// receiveFifoPushes()
+//
+/////////////////////////////////////////////////////////////////
+void ClockDomain::receiveFifoPushes ()
+{
+    for (int i = 0 ; i < m_ports.m_numFifoChannels ; i++)
+    {
+        FifoChannel &channel = m_ports.m_fifoChannels[i];
+        int pushed = descore::atomicLoadAcquire(channel.pushed);
+        if (pushed != channel.received)
+        {
+            schedulePush(channel.fifo, (int) ((unsigned) pushed - (unsigned) channel.received));
+            channel.received = pushed;
+        }
+    }
 }
 
 /////////////////////////////////////////////////////////////////
@@ -550,10 +804,13 @@ void ClockDomain::schedulePush (GenericFifo *fifo)
 // schedulePop()
 //
 /////////////////////////////////////////////////////////////////
-void ClockDomain::schedulePop (GenericFifo *fifo)
+void ClockDomain::schedulePop (GenericFifo *fifo, int count)
 {
     int index = (m_syncIndex + fifo->delay) & m_syncMask;
-    m_syncFifoPop[index].push(fifo);
+    FifoPending &pending = fifo->links->pending[index];
+    if (!(pending.push | pending.pop))
+        m_syncFifos[index].push(fifo);
+    pending.pop += count;
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -596,6 +853,26 @@ void ClockDomain::doAcross (void (PortStorage::*func) ())
     }
 }
 
+////////////////////////////////////////////////////////////////////////
+//
+// getFifoStats()
+//
+////////////////////////////////////////////////////////////////////////
+void ClockDomain::getFifoStats (std::vector<FifoStats> &stats)
+{
+    ClockDomain *domainList;
+    for (domainList = s_first ; domainList ; domainList = domainList->m_nextDifferentTick)
+    {
+        for (ClockDomain *domain = domainList ; domain ; domain = domain->m_nextSameTick)
+            domain->m_ports.getFifoStats(stats);
+    }
+    for (domainList = s_firstManual ; domainList ; domainList = domainList->m_nextDifferentTick)
+    {
+        for (ClockDomain *domain = domainList ; domain ; domain = domain->m_nextSameTick)
+            domain->m_ports.getFifoStats(stats);
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////
 //
 // initialize()
@@ -615,6 +892,7 @@ void ClockDomain::initialize ()
         ClockDomain *next = domain->m_nextDifferentTick;
         domain->scheduleClockDomain();
         domain = next;
+        s_numScheduledDomains++;
     }
 
     // Now that the update wrappers have been sorted, we can initialize
@@ -708,16 +986,19 @@ void ClockDomain::resolvePeriod ()
 // resetDomains()
 //
 /////////////////////////////////////////////////////////////////
-static void resetPendingFifos (stack<GenericFifo *> &fifos)
+static void resetPendingFifos (stack<GenericFifo *> &fifos, int slot)
 {
     // Drop pending fifo events for any fifos that have been reset.
     for (int i = 0 ; i < fifos.size() ; i++)
     {
-        if (fifos[i]->head == 0 && 
-            fifos[i]->tail == 0 && 
-            fifos[i]->fullCount == 0 && 
-            fifos[i]->freeCount == (fifos[i]->size / fifos[i]->dataSize))
+        GenericFifo *fifo = fifos[i];
+        if (fifo->head == 0 && 
+            fifo->tail == 0 && 
+            fifo->fullCount == 0 && 
+            fifo->freeCount == (fifo->size / fifo->dataSize))
         {
+            fifo->links->pending[slot].push = 0;
+            fifo->links->pending[slot].pop = 0;
             GenericFifo *f = fifos.pop();
             if (i < fifos.size())
                 fifos[i--] = f;
@@ -732,10 +1013,11 @@ void ClockDomain::resetDomains ()
 
 void ClockDomain::resetDomain ()
 {
+    m_quietEdges = 0;
+    receiveFifoPushes();
     for (int i = 0 ; i < m_syncDepth ; i++)
     {
-        resetPendingFifos(m_syncFifoPush[i]);
-        resetPendingFifos(m_syncFifoPop[i]);
+        resetPendingFifos(m_syncFifos[i], i);
         m_syncTriggers[i].clear();
     }
 }
@@ -758,11 +1040,10 @@ void ClockDomain::resetPorts ()
 void ClockDomain::resetEvents ()
 {
     doAcross(&ClockDomain::resetEventsInternal);
+    s_timedEvents.clear();
 }
 void ClockDomain::resetEventsInternal ()
 {
-    for_map_values (IEvent *event, m_events)
-        delete event;
     m_events.clear();
 }
 
@@ -845,16 +1126,7 @@ void ClockDomain::resetSyncTrigger (S_Trigger *trigger)
     {
         const byte *value = m_ports.m_portData + offset + m_ports.m_delayOffset[i];
 
-        bool zero = true;
-        for (unsigned j = 0 ; j < trigger->size ; j++)
-        {
-            if (value[j])
-            {
-                zero = false;
-                break;
-            }
-        }
-
+        bool zero = isZero(value, trigger->size);
         if (zero == (bool) trigger->activeLow)
         {
             TriggerStack &triggers = m_syncTriggers[(m_syncIndex + trigger->delay - i) & m_syncMask];
@@ -921,6 +1193,11 @@ void ClockDomain::initPorts ()
 
     // Initialize the port storage
     m_ports.initPorts(this);
+
+    // Registers whose inputs are copied from other domains or from wires can
+    // change while this domain is idle, so their copies and delay chains must
+    // keep running on skipped edges.
+    m_externalRegs = m_ports.m_patchedRegs.size() || m_ports.m_wiredRegs.size() || m_ports.m_slowRegs.size();
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -996,8 +1273,13 @@ void ClockDomain::createUpdateArray ()
 
     // We can allocate the vector of synchronous trigger/fifo lists now
     m_syncTriggers = new TriggerStack[m_syncDepth];
-    m_syncFifoPush = new stack<GenericFifo *>[m_syncDepth];
-    m_syncFifoPop = new stack<GenericFifo *>[m_syncDepth];
+    m_syncFifos = new stack<GenericFifo *>[m_syncDepth];
+    m_ports.initDelayedFifos(m_syncDepth);
+
+    // Coalesce the triggers of single-byte port arrays (the sentinel triggers are
+    // evaluated individually)
+    if (params.CoalesceArrayTriggers)
+        coalesceTriggers(m_updateWrappers);
 
     // Now that triggers have been assigned we can compute the size of
     // every update and trigger structure
@@ -1005,14 +1287,103 @@ void ClockDomain::createUpdateArray ()
 
     // Finally, create and write the update array
     Sim::stats.numUpdateBytes += m_updateSize;
-    m_updates = new byte[m_updateSize];
+    m_updates = allocSimMemory(m_updateSize);
     writeUpdates(firstUpdate);
 
+    // Record the components whose activation is checked by isIdle().  Placeholder
+    // updates with triggers are evaluated on every edge, so their domains can't
+    // skip edges.
+    m_canSkipEdges = true;
+    for (byte *curr = m_updates ; curr < m_updates + m_updateSize ; )
+    {
+        S_Update *update = (S_Update *) curr;
+        if (update->component)
+        {
+            if (!m_updateComponents.size() || (m_updateComponents[m_updateComponents.size() - 1] != update->component))
+                m_updateComponents.push_back(update->component);
+        }
+        else if (update->numTriggers)
+            m_canSkipEdges = false;
+        curr += sizeof(S_Update) + update->numTriggers * sizeof(S_Trigger);
+    }
+
     // Add a sentinel to the end of the sticky triggers to simplify the 
     // loop that iterates over sticky triggers up to a certain point.
     m_stickyTriggers.insert((S_Trigger *) (m_updates + m_updateSize));
 }
 
+////////////////////////////////////////////////////////////////////////
+//
+// coalesceTriggers()
+//
+// Coalesce runs of array ports that are written by the same update
+// function, have a single active-high activation trigger with the same
+// target and delay, and have contiguous values.  Each run is replaced by 
+// a single trigger on the first port whose size is the length of the run
+// so that the entire run is tested at once.  ITriggers are never coalesced
+// because they receive the value of an individual port, and runs of 
+// synchronous triggers are limited to the size of a SyncTrigger value.
+//
+////////////////////////////////////////////////////////////////////////
+bool ClockDomain::getCoalescedTrigger (PortWrapper *port, intptr_t &target, int &delay, byte *&value)
+{
+    if (!port->coalesce || (port->triggers.size() != 1) || port->triggers[0].activeLow)
+        return false;
+    target = port->triggers[0].target;
+    if (target & TRIGGER_ITRIGGER)
+        return false;
+
+    // Resolve the source and delay as in writeTriggers()
+    PortWrapper *source = port;
+    delay = 0;
+    if (port->connection == PORT_SYNCHRONOUS)
+    {
+        source = port->connectedTo;
+        delay = port->delay ? port->delay : 1;
+    }
+
+    // Don't coalesce sticky triggers
+    if ((source->type == PORT_LATCH) || (source->connection == PORT_WIRED) || (source->writers.size() > 1))
+        return false;
+
+    value = source->port->value;
+    return true;
+}
+
+void ClockDomain::coalesceTriggers (UpdateWrapper *w)
+{
+    for ( ; w ; w = w->next)
+    {
+        int numTriggers = 0;
+        for (int i = 0 ; i < w->triggers.size() ; )
+        {
+            PortWrapper *port = w->triggers[i++];
+            w->triggers[numTriggers++] = port;
+
+            intptr_t target;
+            int delay;
+            byte *value;
+            if (!getCoalescedTrigger(port, target, delay, value))
+                continue;
+
+            // S_Trigger::size is a 13-bit field
+            int maxRun = delay ? (int) sizeof(intptr_t) : 0x1fff;
+            while ((i < w->triggers.size()) && (port->coalesceRun < maxRun))
+            {
+                intptr_t nextTarget;
+                int nextDelay;
+                byte *nextValue;
+                if (!getCoalescedTrigger(w->triggers[i], nextTarget, nextDelay, nextValue) ||
+                    (nextTarget != target) || (nextDelay != delay) || (nextValue != value + port->coalesceRun))
+                    break;
+                port->coalesceRun++;
+                i++;
+            }
+        }
+        w->triggers.resize(numTriggers);
+    }
+}
+
 void ClockDomain::setUpdateOffsets (UpdateWrapper *w)
 {
     m_updateSize = 0;
@@ -1071,7 +1442,7 @@ int ClockDomain::writeTriggers (UpdateWrapper *w, byte *&dst)
         {
             S_Trigger *trigger = (S_Trigger *) dst;
             bool activeLow = port->triggers[j].activeLow;
-            bool fast = (port->size == 1) && !activeLow && !latch;
+            bool fast = (port->size == 1) && (port->coalesceRun == 1) && !activeLow && !latch;
 
             // The trigger needs to be evaluated on every cycle after it becomes
             // active if any of the following hold:
@@ -1090,7 +1461,7 @@ int ClockDomain::writeTriggers (UpdateWrapper *w, byte *&dst)
                 m_stickyTriggers.insert(trigger);
 
             trigger->value = source->port->value;
-            trigger->size = port->size;
+            trigger->size = port->size * port->coalesceRun;
             trigger->fast = fast;
             trigger->delay = delay;
             trigger->activeLow = activeLow;
@@ -1134,28 +1505,72 @@ void ClockDomain::addGlobalWavesSignal (Cascade::WavesSignal *s)
 }
 void ClockDomain::dumpWaves ()
 {
+    if (m_skipEdge)
+        return;
     if (!(m_numEdges & 1))
     {
         dumpClocks();
         return;
     }
-    Cascade::WavesSignal *s;
-    for (s = m_waveSignals ; s ; s = s->next)
-        s->dump();
-    for (s = s_globalWaves ; s ; s = s->next)
-        s->dump();
+    if (Waves::enabled)
+    {
+        if (m_waveSignals)
+        {
+            if (!m_waveSnapshot)
+                m_waveSnapshot = new Cascade::WavesSnapshot(m_waveSignals);
+            m_waveSnapshot->dump();
+        }
+    }
     Cascade::WavesFifo *f;
     for (f = m_waveFifos ; f ; f = f->next)
         f->update();
 }
+
+/////////////////////////////////////////////////////////////////
+//
+// dumpGlobalWaves()
+//
+// Global signals (resets and signals without an owning domain) are
+// dumped once per timestamp by the main thread after the domains
+// have dumped their own signals, provided that at least one domain
+// had an unskipped rising edge.  Their records are merged with the
+// per-domain buffers when the waves are flushed.
+//
+/////////////////////////////////////////////////////////////////
+void ClockDomain::dumpGlobalWaves (ClockDomain *runList)
+{
+    if (!s_globalWaves || !Waves::enabled)
+        return;
+
+    ClockDomain *c;
+    for (c = runList ; c ; c = c->m_nextSameTick)
+    {
+        if ((c->m_numEdges & 1) && !c->m_skipEdge)
+            break;
+    }
+    if (!c)
+        return;
+
+    if (!s_globalWavesSnapshot)
+        s_globalWavesSnapshot = new Cascade::WavesSnapshot(s_globalWaves);
+    s_globalWavesSnapshot->dump();
+}
 void ClockDomain::dumpRegQs ()
 {
+    if (!Waves::enabled)
+        return;
     dumpClocks();
-    for (Cascade::WavesSignal *s = m_waveRegQs ; s ; s = s->next)
-        s->dump();
+    if (m_waveRegQs)
+    {
+        if (!m_waveRegQSnapshot)
+            m_waveRegQSnapshot = new Cascade::WavesSnapshot(m_waveRegQs);
+        m_waveRegQSnapshot->dump();
+    }
 }
 void ClockDomain::dumpClocks ()
 {
+    if (!Waves::enabled)
+        return;
     for (Cascade::WavesSignal *s = m_waveClocks ; s ; s = s->next)
         s->dump();
 }
@@ -1258,7 +1673,7 @@ int64 ClockDomain::getTick (int index)
 
 int64 ClockDomain::getNextTick (int index, int64 prevRisingEdge)
 {
-    if (m_generator)
+    if (m_gen_b)
     {
         int n = index / m_gen_b;
         if (index == n * m_gen_b)
@@ -1322,6 +1737,265 @@ void ClockDomain::scheduleClockDomain ()
     }
 }
 
+////////////////////////////////////////////////////////////////////////
+//
+// rescheduleDomains()
+//
+// Re-insert a list of domains that have just been ticked.  Once the 
+// schedule has been built, this replays the recorded list changes for
+// the next step.
+//
+////////////////////////////////////////////////////////////////////////
+void ClockDomain::rescheduleDomains (ClockDomain *runList)
+{
+    if (s_scheduleState == ScheduleReady)
+    {
+        const ScheduleStep &step = s_schedule[s_scheduleIndex];
+        const ScheduleLink *link = s_scheduleLinks.data() + step.firstLink;
+        for (int i = 0 ; i < step.numLinks ; i++, link++)
+        {
+            ClockDomain *domain = link->domain;
+            domain->m_nextDifferentTick = link->nextDifferentTick;
+            domain->m_nextSameTick = link->nextSameTick;
+            domain->m_lastSameTick = link->lastSameTick;
+            domain->m_nextEdge = s_scheduleBase + link->nextEdge;
+        }
+        s_first = step.first;
+        if (++s_scheduleIndex == (int) s_schedule.size())
+        {
+            s_scheduleIndex = 0;
+            s_scheduleBase += s_schedulePeriod;
+        }
+        return;
+    }
+
+    while (runList)
+    {
+        ClockDomain *domain = runList;
+        runList = domain->m_nextSameTick;
+        domain->updateNextEdge();
+        domain->scheduleClockDomain();
+    }
+    if (s_scheduleState == ScheduleNone)
+        buildSchedule();
+}
+
+////////////////////////////////////////////////////////////////////////
+//
+// getScheduleLinks()
+//
+// Get the list links and next edge of every scheduled domain, indexed 
+// by domain id.  Only the head of a same-tick list has meaningful
+// m_nextDifferentTick and m_lastSameTick pointers, so these are set to 
+// NULL for the other domains.
+//
+////////////////////////////////////////////////////////////////////////
+void ClockDomain::getScheduleLinks (std::vector<ScheduleLink> &links, int64 start)
+{
+    for (ClockDomain *d1 = s_first ; d1 ; d1 = d1->m_nextDifferentTick)
+    {
+        for (ClockDomain *d2 = d1 ; d2 ; d2 = d2->m_nextSameTick)
+        {
+            ScheduleLink &link = links[d2->m_id];
+            link.domain = d2;
+            link.nextDifferentTick = (d2 == d1) ? d2->m_nextDifferentTick : NULL;
+            link.nextSameTick = d2->m_nextSameTick;
+            link.lastSameTick = (d2 == d1) ? d2->m_lastSameTick : NULL;
+            link.nextEdge = d2->m_nextEdge - start;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+//
+// buildSchedule()
+//
+// Starting from the current schedule, step through the clock edges
+// doing only the scheduling bookkeeping until the state of every
+// domain repeats shifted by a whole number of nanoseconds (so that 
+// roundTime() behaves identically), recording the domains whose list
+// links or next edge change at each step.  The recording is checked 
+// against a second period before it is used, and the original state 
+// is then restored.  A schedule is only recorded if the edges of every
+// domain follow exactly from whole picosecond values: each domain has
+// its own period, or is divided from its generator by a rational ratio
+// that resynchronizes it to the generator (m_gen_b is set).  Otherwise
+// the domains are always scheduled dynamically.
+//
+////////////////////////////////////////////////////////////////////////
+void ClockDomain::buildSchedule ()
+{
+    s_scheduleState = ScheduleDynamic;
+    if (!params.ClockScheduleSize)
+        return;
+
+    // Collect the domains.  Wait until every domain has ticked and every 
+    // divided domain has been synchronized to its generator, since the 
+    // first edges are not part of the periodic pattern.
+    std::vector<ClockDomain *> domains;
+    ClockDomain *d1, *d2;
+    for (d1 = s_first ; d1 ; d1 = d1->m_nextDifferentTick)
+    {
+        for (d2 = d1 ; d2 ; d2 = d2->m_nextSameTick)
+        {
+            if (d2->m_generator && !d2->m_gen_b)
+                return;
+            if ((d2->m_numTicks < 2) || (d2->m_generator && 
+                ((d2->m_generator->m_numTicks + d2->m_gen_m < 0) || (d2->m_prevIndex < 2 * d2->m_gen_b))))
+            {
+                s_scheduleState = ScheduleNone;
+                return;
+            }
+            domains.push_back(d2);
+        }
+    }
+
+    // Save the current state
+    struct DomainState
+    {
+        ClockDomain *nextDifferentTick;
+        ClockDomain *nextSameTick;
+        ClockDomain *lastSameTick;
+        int64 nextEdge;
+        int64 prevTick;
+        int   numTicks;
+        int   numEdges;
+        int   prevIndex;
+    };
+    int numDomains = (int) domains.size();
+    std::vector<DomainState> saved(numDomains);
+    ClockDomain *first = s_first;
+    int64 start = s_first->m_nextEdge;
+    int i;
+    for (i = 0 ; i < numDomains ; i++)
+    {
+        d1 = domains[i];
+        DomainState state = { d1->m_nextDifferentTick, d1->m_nextSameTick, d1->m_lastSameTick, 
+            d1->m_nextEdge, d1->m_prevTick, d1->m_numTicks, d1->m_numEdges, d1->m_prevIndex };
+        saved[i] = state;
+    }
+    ScheduleLink nullLink = { NULL, NULL, NULL, NULL, 0 };
+    std::vector<ScheduleLink> initial(s_numClockDomains, nullLink);
+    getScheduleLinks(initial, start);
+    std::vector<ScheduleLink> prev(initial);
+    std::vector<ScheduleLink> curr(initial);
+
+    int maxSteps = (int) params.ClockScheduleSize;
+    int numSteps = 0;
+    int64 period = 0;
+    bool valid = false;
+    s_schedule.clear();
+    s_scheduleLinks.clear();
+    for (int step = 0 ; step < 2 * maxSteps ; step++)
+    {
+        // Advance the domains through the next edge
+        ClockDomain *runList = s_first;
+        s_first = s_first->m_nextDifferentTick;
+        for (d1 = runList ; d1 ; d1 = d1->m_nextSameTick)
+        {
+            if ((++d1->m_numEdges & 1) && d1->m_numTicks++)
+            {
+                d1->m_prevTick = d1->m_nextEdge;
+                d1->m_prevIndex++;
+            }
+        }
+        while (runList)
+        {
+            d1 = runList;
+            runList = d1->m_nextSameTick;
+            d1->updateNextEdge();
+            d1->scheduleClockDomain();
+        }
+
+        // Record the domains that changed
+        getScheduleLinks(curr, start);
+        ScheduleStep entry = { s_first, (int) s_scheduleLinks.size(), 0 };
+        for (i = 0 ; i < s_numClockDomains ; i++)
+        {
+            if (curr[i].domain && !curr[i].matches(prev[i], 0))
+            {
+                s_scheduleLinks.push_back(curr[i]);
+                entry.numLinks++;
+                prev[i] = curr[i];
+            }
+        }
+        s_schedule.push_back(entry);
+
+        if (!period)
+        {
+            // Check to see if the state has repeated
+            int64 shift = s_first->m_nextEdge - start;
+            if ((s_first == first) && !(shift % 1000))
+            {
+                for (i = 0 ; i < numDomains ; i++)
+                {
+                    d1 = domains[i];
+                    const DomainState &state = saved[i];
+                    if (!curr[d1->m_id].matches(initial[d1->m_id], shift) ||
+                        (d1->m_prevTick != state.prevTick + shift) ||
+                        ((d1->m_numEdges ^ state.numEdges) & 1) ||
+                        (d1->m_generator && ((d1->m_prevIndex - state.prevIndex) % d1->m_gen_b)))
+                        break;
+                }
+                if (i == numDomains)
+                {
+                    period = shift;
+                    numSteps = step + 1;
+                    continue;
+                }
+            }
+            if (step + 1 == maxSteps)
+                break;
+        }
+        else if (step + 1 == 2 * numSteps)
+        {
+            // Verify that the second period replays the first
+            valid = true;
+            for (int j = 0 ; valid && (j < numSteps) ; j++)
+            {
+                const ScheduleStep &s1 = s_schedule[j];
+                const ScheduleStep &s2 = s_schedule[j + numSteps];
+                valid = (s1.first == s2.first) && (s1.numLinks == s2.numLinks);
+                for (int k = 0 ; valid && (k < s1.numLinks) ; k++)
+                    valid = s_scheduleLinks[s2.firstLink + k].matches(s_scheduleLinks[s1.firstLink + k], period);
+            }
+            break;
+        }
+    }
+
+    // Restore the original state
+    s_first = first;
+    for (i = 0 ; i < numDomains ; i++)
+    {
+        d1 = domains[i];
+        const DomainState &state = saved[i];
+        d1->m_nextDifferentTick = state.nextDifferentTick;
+        d1->m_nextSameTick = state.nextSameTick;
+        d1->m_lastSameTick = state.lastSameTick;
+        d1->m_nextEdge = state.nextEdge;
+        d1->m_prevTick = state.prevTick;
+        d1->m_numTicks = state.numTicks;
+        d1->m_numEdges = state.numEdges;
+        d1->m_prevIndex = state.prevIndex;
+    }
+
+    if (valid)
+    {
+        s_schedule.resize(numSteps);
+        s_scheduleLinks.resize(s_schedule[numSteps - 1].firstLink + s_schedule[numSteps - 1].numLinks);
+        s_scheduleState = ScheduleReady;
+        s_scheduleIndex = 0;
+        s_scheduleBase = start;
+        s_schedulePeriod = period;
+        logInfo("Clock schedule: %d steps with a period of %lld ps\n", numSteps, (long long) period);
+    }
+    else
+    {
+        std::vector<ScheduleStep>().swap(s_schedule);
+        std::vector<ScheduleLink>().swap(s_scheduleLinks);
+    }
+}
+
 /////////////////////////////////////////////////////////////////
 //
 // scheduleEvent()
@@ -1332,18 +2006,51 @@ void ClockDomain::scheduleEvent (int delay, IEvent *event)
     int ticks = m_numTicks + delay;
 
     // If this is called from reset(), then check to make sure we're not duplicating an event
-    if (Sim::state == Sim::SimResetting)
+    if ((Sim::state == Sim::SimResetting) && m_events.contains(m_numTicks, ticks, event))
     {
-        for (Iterator<EventMap> it(m_events, ticks, ticks) ; it ; it++)
-        {
-            if (event->equals(*it))
-            {
-                delete event;
-                return;
-            }
-        }
+        delete event;
+        return;
     }
-    m_events.insert(EventMap::value_type(ticks, event));
+    m_events.schedule(m_numTicks, ticks, event);
+}
+
+////////////////////////////////////////////////////////////////////////
+//
+// scheduleTimedEvent()
+//
+////////////////////////////////////////////////////////////////////////
+void ClockDomain::scheduleTimedEvent (uint64 time, IEvent *event)
+{
+    // Clock domains may be ticking in parallel, so buffer the event in the
+    // current domain until the edge completes.
+    if (t_currentClockDomain)
+    {
+        TimedEvent timedEvent = { time, event };
+        t_currentClockDomain->m_timedEvents.push(timedEvent);
+        return;
+    }
+
+    // If this is called from reset(), then check to make sure we're not duplicating an event
+    if ((Sim::state == Sim::SimResetting) && s_timedEvents.contains(time, event))
+    {
+        delete event;
+        return;
+    }
+    s_timedEvents.schedule(time, event);
+}
+
+////////////////////////////////////////////////////////////////////////
+//
+// flushTimedEvents()
+//
+////////////////////////////////////////////////////////////////////////
+void ClockDomain::flushTimedEvents ()
+{
+    // If this domain was manually ticked from within another domain's clock
+    // edge, then the events are passed on to that domain's buffer.
+    for (int i = 0 ; i < m_timedEvents.size() ; i++)
+        scheduleTimedEvent(m_timedEvents[i].time, m_timedEvents[i].event);
+    m_timedEvents.clear();
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -1372,6 +2079,7 @@ void ClockDomain::archiveClockDomains (Archive &ar)
 
         // Clear the schedule
         s_first = NULL;
+        s_scheduleState = ScheduleNone;
 
         // Archive the domains
         for (int i = 0 ; i < s_numClockDomains ; i++)
@@ -1410,6 +2118,16 @@ void ClockDomain::archiveClockDomains (Archive &ar)
     CascadeValidate(numDomains == s_numClockDomains, "Somebody dropped a clock domain");
 }
 
+////////////////////////////////////////////////////////////////////////
+//
+// archiveTimedEvents()
+//
+////////////////////////////////////////////////////////////////////////
+void ClockDomain::archiveTimedEvents (Archive &ar)
+{
+    s_timedEvents.archive(ar);
+}
+
 ////////////////////////////////////////////////////////////////////////
 //
 // archive()
@@ -1431,12 +2149,20 @@ void ClockDomain::archive (Archive &ar)
     // Make sure the state of the sticky triggers is consistent
     resetTriggers(false);
 
-    // Archive fifo events scheduled for a future rising clock edge
+    // Archive fifo events scheduled for a future rising clock edge.  Pushes
+    // from other clock domains are scheduled first so that the channels are
+    // empty; they are not archived.
+    if (ar.isLoading())
+    {
+        for (int i = 0 ; i < m_ports.m_numFifoChannels ; i++)
+            m_ports.m_fifoChannels[i].pushed = m_ports.m_fifoChannels[i].received = 0;
+    }
+    else
+        receiveFifoPushes();
     ar | m_syncIndex;
     for (int i = 0 ; i < m_syncDepth ; i++)
     {
-        m_ports.archiveFifoStack(ar, m_syncFifoPush[i]);
-        m_ports.archiveFifoStack(ar, m_syncFifoPop[i]);
+        m_ports.archiveFifoStack(ar, m_syncFifos[i], i);
     }
 
     // A WavesFifo needs to know how many in-flight pushes there are, so the consumer
@@ -1449,8 +2175,8 @@ void ClockDomain::archive (Archive &ar)
         // Count the in-flight pushes
         for (int i = 0 ; i < m_syncDepth ; i++)
         {
-            for (int j = 0 ; j < m_syncFifoPush[i].size() ; j++)
-                m_syncFifoPush[i][j]->fullCount++;
+            for (int j = 0 ; j < m_syncFifos[i].size() ; j++)
+                m_syncFifos[i][j]->fullCount += m_syncFifos[i][j]->links->pending[i].push;
         }
 
         // Copy this information to the waves
@@ -1491,9 +2217,10 @@ void ClockDomain::archive (Archive &ar)
     }
 
     // Archive events
-    if (ar.isLoading())
-        resetEvents();
-    ar | m_events;
+    m_events.archive(ar, m_numTicks);
+
+    // Simulate the next rising edge in full
+    m_quietEdges = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -1513,41 +2240,73 @@ void ClockDomain::runSimulation (uint64 runUntil)
     // In a Verilog-driven simulations there might not be any scheduled clock domains
     if (Sim::isVerilogSimulation && !s_first)
     {
+        while (s_timedEvents.size() && (s_timedEvents.nextTime() < runUntil))
+        {
+            Sim::simTime = s_timedEvents.nextTime();
+            s_timedEvents.fireEvents();
+        }
         Sim::simTime = runUntil;
         return;
     }
 
     assert_always(s_first, "No scheduled clock domains: cannot run simulation");
 
+    // Ports may have been modified since the last call
+    wakeDomains();
+
     bool runSingleTick = (runUntil == 0);
     if (runSingleTick)
         runUntil = (uint64) 0x7fffffffffffffffLL;
 
-    while (s_first->m_nextEdge < (int64) runUntil)
+    for (;;)
     {
-        CascadeValidate((int64) Sim::simTime <= s_first->m_nextEdge, "Simulation went backwards in time");
-        Sim::simTime = s_first->m_nextEdge;
+        // Timed events fire before any clock edges at the same time
+        int64 nextTime = s_first->m_nextEdge;
+        bool fireTimedEvents = s_timedEvents.size() && ((int64) s_timedEvents.nextTime() <= nextTime);
+        if (fireTimedEvents)
+            nextTime = s_timedEvents.nextTime();
+        if (nextTime >= (int64) runUntil)
+            break;
+
+        CascadeValidate((int64) Sim::simTime <= nextTime, "Simulation went backwards in time");
+        Sim::simTime = nextTime;
         assert_always(!params.Timeout || (Sim::simTime < uint64(params.Timeout) * 1000), "Simulation timed out");
-        if (params.Finish && (Sim::simTime >= uint64(params.Finish) * 1000))
+        bool finish = params.Finish && (Sim::simTime >= uint64(params.Finish) * 1000);
+        bool replayDone = params.ReplayWaves && (Sim::simTime / 1000 > params.WavesStopTime);
+        if (finish || replayDone)
         {
 #ifdef _VERILOG
             if (Sim::isVerilogSimulation)
                 tf_dofinish();
             else
 #endif
+            {
+                // Close the waves file, since exit() skips its destructor
+                Waves::cleanup();
                 exit(0);
+            }
         }
 
         // Checkpoints
         if (Sim::simTime >= Sim::nextCheckpoint)
         {
-            SimArchive::saveSimulation(*str("%s_%u.ckp", params.CheckpointName->c_str(), (unsigned) (s_first->m_nextEdge / 1000)), params.SafeCheckpoint);
+            SimArchive::saveSimulation(*str("%s_%u.ckp", params.CheckpointName->c_str(), (unsigned) (nextTime / 1000)), params.SafeCheckpoint);
             if (params.CheckpointInterval)
                 Sim::nextCheckpoint += params.CheckpointInterval * 1000;
             else
                 Sim::nextCheckpoint = (uint64) 0x7fffffffffffffffLL;
         }
 
+        // Fire the batch of timed events for this time
+        if (fireTimedEvents)
+        {
+            Sim::tracing = (Sim::simTime >= 1000 * params.TraceStartTime && Sim::simTime <= 1000 * params.TraceStopTime);
+            s_timedEvents.fireEvents();
+            wakeDomains();
+            if (nextTime < s_first->m_nextEdge)
+                continue;
+        }
+
         // Strip off the first list of clock domains (which have the same nextTick time)
         ClockDomain *runList = s_first;
         s_first = s_first->m_nextDifferentTick;
@@ -1555,7 +2314,7 @@ void ClockDomain::runSimulation (uint64 runUntil)
         Sim::tracing = (Sim::simTime >= 1000 * params.TraceStartTime && Sim::simTime <= 1000 * params.TraceStopTime);
 
         // Tick the domains
-        tickDomains(runList);
+        tickDomains(runList, true);
 
         // Check to see if there was a rising edge (don't count falling edges when
         // we're running for a single tick).
@@ -1564,23 +2323,76 @@ void ClockDomain::runSimulation (uint64 runUntil)
             risingEdge |= ((c->m_numEdges & 1) != 0);
 
         // Reschedule the clock domains
-        while (runList)
-        {
-            ClockDomain *domain = runList;
-            runList = domain->m_nextSameTick;
-            domain->updateNextEdge();
-            domain->scheduleClockDomain();
-        }
+        rescheduleDomains(runList);
 
         if (runSingleTick && (risingEdge || Sim::verilogCallbackPump))
         {
             runUntil = s_first->m_nextEdge;
             break;
         }
+
+        // If every scheduled domain is idle, then skip ahead to the next time at 
+        // which something can happen.
+        if (s_numIdleDomains == s_numScheduledDomains)
+        {
+            uint64 limit = std::min(runUntil, Sim::nextCheckpoint);
+            if (s_timedEvents.size())
+                limit = std::min(limit, s_timedEvents.nextTime());
+            if (params.Timeout)
+                limit = std::min(limit, uint64(params.Timeout) * 1000);
+            if (params.Finish)
+                limit = std::min(limit, uint64(params.Finish) * 1000);
+            skipIdleTime(limit);
+        }
     }
     Sim::simTime = runUntil;
 }
 
+/////////////////////////////////////////////////////////////////
+//
+// skipIdleTime()
+//
+// Called when every scheduled clock domain is idle.  Nothing can 
+// happen until a domain has an event due, so advance the domains 
+// through their edges up to that point (or up to limit) doing only 
+// the edge bookkeeping.  The idle conditions guarantee that no
+// component is active; the delay chains and sync rings of each domain
+// are also checked to have drained before its edges are skipped, so 
+// there are no delayed register or fifo arrivals to wait for.  The
+// registers fed from outside a domain are still copied and shifted on
+// every edge, since their sources may have changed on the last edges.
+//
+/////////////////////////////////////////////////////////////////
+void ClockDomain::skipIdleTime (uint64 limit)
+{
+    while (s_first->m_nextEdge < (int64) limit)
+    {
+        ClockDomain *c;
+        for (c = s_first ; c ; c = c->m_nextSameTick)
+        {
+            if (!(c->m_numEdges & 1) && (c->m_events.isDue(c->m_numTicks + 1) || !c->isDrained()))
+                return;
+        }
+
+        ClockDomain *runList = s_first;
+        s_first = s_first->m_nextDifferentTick;
+        Sim::simTime = runList->m_nextEdge;
+        Sim::simTicks++;
+        for (c = runList ; c ; c = c->m_nextSameTick)
+            c->m_numEdges++;
+        tickSkippedRegisters(runList);
+        for (c = runList ; c ; c = c->m_nextSameTick)
+        {
+            if (c->m_numEdges & 1)
+            {
+                c->skipEdge();
+                Sim::stats.numSkippedEdges++;
+            }
+        }
+        rescheduleDomains(runList);
+    }
+}
+
 /////////////////////////////////////////////////////////////////
 //
 // tickDomains()
@@ -1592,9 +2404,65 @@ void ClockDomain::runSimulation (uint64 runUntil)
     Sim::stats.stat += t2 - t1; \
     t1 = t2
 
-void ClockDomain::tickDomains (ClockDomain *runList)
+void ClockDomain::tickDomains (ClockDomain *runList, bool skipIdle)
 {
     uint64 t1, t2;
+    ClockDomain *c;
+
+    // Apply the waves dumping window and any runtime dumping requests
+    Waves::nextStep();
+    if (!t_currentClockDomain)
+        Waves::updateDumping();
+
+    // Update the edge count and drive verilog from the main thread.  Falling
+    // edges only dump the clock waves, so they can always be skipped otherwise.
+    bool skipAll = true;
+    bool fullEdge = false;
+    for (c = runList ; c ; c = c->m_nextSameTick)
+    {
+        c->m_numEdges++;
+        c->driveVerilogClocks();
+        if (!skipIdle || !params.SkipIdleEdges)
+            c->m_skipEdge = false;
+        else if (c->m_numEdges & 1)
+        {
+            c->m_skipEdge = c->isIdle();
+            if (c->m_skipEdge)
+                Sim::stats.numIdleEdges++;
+        }
+        else
+            c->m_skipEdge = !c->m_waveClocks || !Waves::enabled;
+        skipAll &= c->m_skipEdge;
+
+        // Count the domains that have been idle since the last full rising edge
+        if (c->m_numEdges & 1)
+        {
+            if (!c->m_skipEdge)
+                fullEdge = true;
+            else if (c->m_idleEpoch != s_idleEpoch)
+            {
+                c->m_idleEpoch = s_idleEpoch;
+                s_numIdleDomains++;
+            }
+        }
+    }
+    if (fullEdge)
+    {
+        s_idleEpoch++;
+        s_numIdleDomains = 0;
+    }
+
+    // If every domain is skipping this edge then there's no need to involve the threads
+    if (skipAll)
+    {
+        tickSkippedRegisters(runList);
+        for (c = runList ; c ; c = c->m_nextSameTick)
+        {
+            if (c->m_numEdges & 1)
+                c->skipEdge();
+        }
+        return;
+    }
 
     // Once every 10 seconds, check for non-empty queues feeding
     // deactivated components (indicates a deactivation bug).
@@ -1606,13 +2474,6 @@ void ClockDomain::tickDomains (ClockDomain *runList)
 
     t1 = getTimer();
 
-    // Update the edge count and drive verilog from the main thread
-    for (ClockDomain *c = runList ; c ; c = c->m_nextSameTick)
-    {
-        c->m_numEdges++;
-        c->driveVerilogClocks();
-    }
-
     // Tick the clock domains
     runThreaded(runList, &ClockDomain::preTick);
     TIMESTAT(preTickTime);
@@ -1628,8 +2489,23 @@ void ClockDomain::tickDomains (ClockDomain *runList)
     runThreaded(runList, &ClockDomain::update);
     TIMESTAT(updateTime);
 
-    // Dump waves
+    // Dump waves.  The waves step is advanced again so that the rest of an 
+    // enclosing tickDomains() call (from a manual clock tick) is ordered after
+    // the changes of this one.
     runThreaded(runList, &ClockDomain::dumpWaves);
+    if (!t_currentClockDomain)
+    {
+        dumpGlobalWaves(runList);
+        Waves::flush();
+    }
+    Waves::nextStep();
+
+    // Move timed events from the domains to the global queue in domain order
+    for (c = runList ; c ; c = c->m_nextSameTick)
+    {
+        if (!c->m_timedEvents.empty())
+            c->flushTimedEvents();
+    }
 }
 
 /////////////////////////////////////////////////////////////////
@@ -1791,16 +2667,7 @@ void ClockDomain::evalTrigger (S_Trigger *trigger)
     }
     else
     {
-        bool zero = true;
-        for (unsigned i = 0 ; i < trigger->size ; i++)
-        {
-            if (trigger->value[i])
-            {
-                zero = false;
-                break;
-            }
-        }
-
+        bool zero = isZero(trigger->value, trigger->size);
         if (zero == (bool) trigger->activeLow)
         {
             if (trigger->delay)
@@ -1827,16 +2694,21 @@ void ClockDomain::update ()
     if (!(m_numEdges & 1))
         return;
 
+    if (m_skipEdge)
+        return;
+
     int i;
 
+    // Record the fifos that are empty before the updates for the fifo statistics
+    if (params.FifoStats && m_ports.m_fifoStats)
+        m_ports.sampleFifoStarvation();
+
     // First fire all of the events scheduled for this clock cycle
-    while (m_events.size() && (m_events.begin()->first == m_numTicks))
+    bool quiet = m_quiet;
+    if (m_events.isDue(m_numTicks))
     {
-        EventMap::iterator it = m_events.begin();
-        IEvent *event = it->second;
-        event->fireEvent();
-        delete event;
-        m_events.erase(it);
+        quiet = false;
+        m_events.fireEvents(m_numTicks);
     }
 
     // Now do all the combinational updates
@@ -1854,6 +2726,7 @@ void ClockDomain::update ()
             if (component->isActive())
             {
                 Sim::stats.numActiveUpdates++;
+                quiet = false;
                 (component->*(t_currentUpdate->fn))();
             }
             else
@@ -1872,6 +2745,7 @@ void ClockDomain::update ()
             evalTrigger((S_Trigger *) curr);
     }
     t_currentUpdate = NULL;
+    m_quietEdges = quiet ? m_quietEdges + 1 : 0;
 }
 
 END_NAMESPACE_CASCADE
@@ -279,6 +279,17 @@ void Component::scheduleEventInternal (int delay, Cascade::IEvent *event)
     domain->scheduleEvent(delay, event);
 }
 
+/////////////////////////////////////////////////////////////////
+//
+// scheduleTimedEventInternal()
+//
+/////////////////////////////////////////////////////////////////
+void Component::scheduleTimedEventInternal (uint64 delay, Cascade::IEvent *event)
+{
+    assert_always(delay > 0, "Attempted to schedule timed event with zero delay");
+    ClockDomain::scheduleTimedEvent(Sim::simTime + delay, event);
+}
+
 /////////////////////////////////////////////////////////////////
 //
 // getTickCount()
@@ -0,0 +1,811 @@
+/*
+Copyright 2007, D. E. Shaw Research.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+* Redistributions of source code must retain the above copyright
+  notice, this list of conditions, and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions, and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+* Neither the name of D. E. Shaw Research nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+//////////////////////////////////////////////////////////////////////
+//
+// CwfWavesFile.cpp
+//
+// Copyright (C) 2026 D. E. Shaw Research
+//
+// Created: 10/18/2026
+//
+// Compact binary waves file (cascade.WavesFormat = Cwf).  All 
+// fixed-size integers are little-endian; varints are LEB128 (seven
+// bits per byte, low bits first, high bit set on all but the last
+// byte); strings are a varint length followed by the characters.
+//
+//   Header:   "CASCWAVE" uint32(version = 1) 
+//             uint32(length) date, uint32(length) version, 
+//             uint32(length) timescale
+//   Blocks:   byte(type) uint64(start time) uint64(end time) 
+//             uint32(uncompressed size) uint32(compressed size)
+//             zlib-compressed contents
+//   Index:    byte('I') uint32(number of value change blocks)
+//             { uint64(start time) uint64(end time) uint64(offset) }*
+//   Trailer:  uint64(offset of index) "CASCWEND"
+//
+// There is one hierarchy block (type 'H') followed by any number of
+// value change blocks (type 'D').  The hierarchy block contains the
+// records
+//
+//   'S' string(name)              Begin a scope
+//   'V' varint(size) string(name) Define a signal.  Signals are 
+//                                 numbered consecutively from 1.
+//   'U'                           End a scope
+//
+// A value change block starts with a time record and contains
+//
+//   varint(0) varint(delta)       Advance the time by delta from the
+//                                 previous time (or from the block
+//                                 start time for the first record)
+//   varint(2 * id + 1)            The signal value is undefined
+//   varint(2 * id) value          The signal value as (size + 7) / 8
+//                                 little-endian bytes
+//   varint(1) varint(n)           The next n value records are a 
+//                                 snapshot of every signal that has a
+//                                 value at the start of the block
+//
+// The initial time record of each value change block is followed by a
+// snapshot, so a block can be decoded without reading the preceding 
+// blocks.
+//
+// The index allows a reader to locate the blocks for a range of time
+// without decompressing the preceding blocks.  It is missing if the 
+// simulation did not exit cleanly; the blocks can still be read in
+// sequence.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "stdafx.h"
+#include "Cascade.hpp"
+
+#ifdef _MSC_VER
+#include <zlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+#define CWF_VERSION 1
+
+BEGIN_NAMESPACE_CASCADE
+
+static const char CWF_MAGIC[] = "CASCWAVE";
+static const char CWF_END_MAGIC[] = "CASCWEND";
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Little-endian file I/O
+//
+////////////////////////////////////////////////////////////////////////////////
+static void write32 (FILE *f, uint32 val)
+{
+    byte b[4];
+    for (int i = 0 ; i < 4 ; i++, val >>= 8)
+        b[i] = (byte) val;
+    fwrite(b, 1, 4, f);
+}
+
+static void write64 (FILE *f, uint64 val)
+{
+    write32(f, (uint32) val);
+    write32(f, (uint32) (val >> 32));
+}
+
+static void writeString (FILE *f, const char *str)
+{
+    uint32 len = (uint32) strlen(str);
+    write32(f, len);
+    fwrite(str, 1, len, f);
+}
+
+static bool read32 (FILE *f, uint32 &val)
+{
+    byte b[4];
+    if (fread(b, 1, 4, f) != 4)
+        return false;
+    val = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32) b[3] << 24);
+    return true;
+}
+
+static bool read64 (FILE *f, uint64 &val)
+{
+    uint32 lo, hi;
+    if (!read32(f, lo) || !read32(f, hi))
+        return false;
+    val = lo | ((uint64) hi << 32);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// CwfWavesFile
+//
+////////////////////////////////////////////////////////////////////////////////
+CwfWavesFile::CwfWavesFile () :
+m_data(NULL),
+m_size(0),
+m_capacity(params.WavesBlockSize + 256),
+m_nextId(1),
+m_blockStart(0),
+m_lastTime(0),
+m_offset(0),
+m_sizes(1, 0),
+m_valueOffset(1, 0),
+m_valueState(1, 0),
+m_numValues(0),
+m_exitCompressors(false)
+{
+    m_data = new byte[m_capacity];
+}
+
+CwfWavesFile::~CwfWavesFile ()
+{
+    drain();
+    if (m_file)
+    {
+        if ((m_currSimTime != uint64(-1)) && (Sim::simTime > m_currTime))
+            dumpTime(Sim::simTime);
+        endFile();
+    }
+    stopCompressors();
+    for (int i = 0 ; i < (int) m_pending.size() ; i++)
+        delete m_pending[i];
+    delete[] m_data;
+}
+
+void CwfWavesFile::grow (int bytes)
+{
+    while (m_size + bytes > m_capacity)
+        m_capacity *= 2;
+    byte *data = new byte[m_capacity];
+    memcpy(data, m_data, m_size);
+    delete[] m_data;
+    m_data = data;
+}
+
+void CwfWavesFile::putVarint (uint64 val)
+{
+    while (val >= 0x80)
+    {
+        m_data[m_size++] = (byte) (val | 0x80);
+        val >>= 7;
+    }
+    m_data[m_size++] = (byte) val;
+}
+
+void CwfWavesFile::putString (const char *str)
+{
+    int len = (int) strlen(str);
+    reserve(len + 10);
+    putVarint(len);
+    memcpy(m_data + m_size, str, len);
+    m_size += len;
+}
+
+void CwfWavesFile::writeBlock (byte type)
+{
+    PendingBlock *block = new PendingBlock;
+    block->type = type;
+    block->startTime = (type == 'D') ? m_blockStart : 0;
+    block->endTime = (type == 'D') ? m_lastTime : 0;
+    block->data.assign(m_data, m_data + m_size);
+    block->state = BlockQueued;
+    m_size = 0;
+
+    // Compress the block in this thread if there are no compression threads
+    int numThreads = params.WavesCompressThreads;
+    if (!numThreads)
+    {
+        compressBlock(block);
+        writeCompressedBlock(block);
+        delete block;
+        return;
+    }
+
+    if (m_compressors.empty())
+    {
+        for (int i = 0 ; i < numThreads ; i++)
+        {
+            m_compressors.push_back(new descore::Thread);
+            m_compressors.back()->start(this, &CwfWavesFile::compressorThread);
+        }
+    }
+    {
+        descore::ScopedSpinLock lock(m_pendingLock);
+        m_pending.push_back(block);
+    }
+
+    // Write the blocks that have been compressed, and wait for the compression
+    // threads if too many blocks are pending
+    writePendingBlocks(false);
+    while ((int) m_pending.size() > 2 * numThreads)
+    {
+        descore::Thread::sleep(1);
+        writePendingBlocks(false);
+    }
+}
+
+void CwfWavesFile::compressBlock (PendingBlock *block)
+{
+    uLong destLen = compressBound((uLong) block->data.size());
+    block->compressed.resize(destLen);
+    assert_always(compress2(&block->compressed[0], &destLen, 
+                            block->data.size() ? &block->data[0] : &block->compressed[0], 
+                            (uLong) block->data.size(), Z_BEST_SPEED) == Z_OK, 
+        "Failed to compress waves data");
+    block->compressed.resize(destLen);
+}
+
+void CwfWavesFile::writeCompressedBlock (const PendingBlock *block)
+{
+    if (block->type == 'D')
+    {
+        BlockIndex index = { block->startTime, block->endTime, m_offset };
+        m_index.push_back(index);
+    }
+    uint32 compressedSize = (uint32) block->compressed.size();
+    fputc(block->type, m_file);
+    write64(m_file, block->startTime);
+    write64(m_file, block->endTime);
+    write32(m_file, (uint32) block->data.size());
+    write32(m_file, compressedSize);
+    fwrite(&block->compressed[0], 1, compressedSize, m_file);
+    m_offset += 25 + compressedSize;
+}
+
+void CwfWavesFile::writePendingBlocks (bool wait)
+{
+    for (;;)
+    {
+        PendingBlock *block = NULL;
+        {
+            descore::ScopedSpinLock lock(m_pendingLock);
+            if (m_pending.empty())
+                return;
+            block = m_pending.front();
+        }
+        if (descore::atomicLoadAcquire(block->state) != BlockCompressed)
+        {
+            if (!wait)
+                return;
+            descore::Thread::yield();
+            continue;
+        }
+        writeCompressedBlock(block);
+        {
+            descore::ScopedSpinLock lock(m_pendingLock);
+            m_pending.pop_front();
+        }
+        delete block;
+    }
+}
+
+void CwfWavesFile::compressorThread ()
+{
+    int numSpins = 0;
+    while (!m_exitCompressors)
+    {
+        // Find the oldest block that has not been claimed by another thread
+        PendingBlock *block = NULL;
+        {
+            descore::ScopedSpinLock lock(m_pendingLock);
+            for (int i = 0 ; i < (int) m_pending.size() ; i++)
+            {
+                if (m_pending[i]->state == BlockQueued)
+                {
+                    block = m_pending[i];
+                    block->state = BlockCompressing;
+                    break;
+                }
+            }
+        }
+        if (!block)
+        {
+            if (++numSpins < 100)
+                descore::Thread::yield();
+            else
+                descore::Thread::sleep(1);
+            continue;
+        }
+        numSpins = 0;
+        compressBlock(block);
+        descore::atomicStoreRelease(block->state, BlockCompressed);
+    }
+}
+
+void CwfWavesFile::stopCompressors ()
+{
+    m_exitCompressors = true;
+    for (int i = 0 ; i < (int) m_compressors.size() ; i++)
+    {
+        m_compressors[i]->wait();
+        delete m_compressors[i];
+    }
+    m_compressors.clear();
+    m_exitCompressors = false;
+}
+
+void CwfWavesFile::writeSnapshot ()
+{
+    reserve(21);
+    putVarint(1);
+    putVarint(m_numValues);
+    for (uint32 id = 1 ; id < m_valueState.size() ; id++)
+    {
+        if (!m_valueState[id])
+            continue;
+        int numBytes = (m_sizes[id] + 7) / 8;
+        reserve(numBytes + 10);
+        if (m_valueState[id] == 2)
+            putVarint(2 * id + 1);
+        else
+        {
+            putVarint(2 * id);
+            memcpy(m_data + m_size, &m_values[m_valueOffset[id]], numBytes);
+            m_size += numBytes;
+        }
+    }
+}
+
+void CwfWavesFile::beginFile ()
+{
+    assert(m_file);
+
+    // Date
+    time_t ltime;
+    char t[64];
+    time(&ltime);
+#if defined _MSC_VER
+    ctime_s(t,sizeof(t),&ltime);
+#else
+    ctime_r(&ltime, t);
+#endif
+    t[strlen(t)-1] = '\0';
+
+    // Header
+    strbuff version("Cascade version %s", CASCADE_VERSION);
+    fwrite(CWF_MAGIC, 1, 8, m_file);
+    write32(m_file, CWF_VERSION);
+    writeString(m_file, t);
+    writeString(m_file, version);
+    writeString(m_file, **params.WavesTimescale);
+    m_offset = 24 + strlen(t) + strlen(version) + strlen(**params.WavesTimescale);
+}
+
+void CwfWavesFile::endFile ()
+{
+    assert(m_file);
+    descore::ScopedSpinLock lock(m_lock);
+    if (m_size)
+        writeBlock('D');
+    writePendingBlocks(true);
+    stopCompressors();
+
+    uint64 indexOffset = m_offset;
+    fputc('I', m_file);
+    write32(m_file, (uint32) m_index.size());
+    for (int i = 0 ; i < (int) m_index.size() ; i++)
+    {
+        write64(m_file, m_index[i].startTime);
+        write64(m_file, m_index[i].endTime);
+        write64(m_file, m_index[i].offset);
+    }
+    write64(m_file, indexOffset);
+    fwrite(CWF_END_MAGIC, 1, 8, m_file);
+    fflush(m_file);
+}
+
+void CwfWavesFile::beginComponent (const char *name)
+{
+    assert(m_file);
+    reserve(1);
+    m_data[m_size++] = 'S';
+    putString(name);
+}
+
+uint32 CwfWavesFile::addSignal (const char *name, int sizeInBits)
+{
+    assert(m_file);
+    reserve(11);
+    m_data[m_size++] = 'V';
+    putVarint(sizeInBits);
+    putString(name);
+
+    m_sizes.push_back(sizeInBits);
+    m_valueOffset.push_back((uint32) m_values.size());
+    m_valueState.push_back(0);
+    m_values.resize(m_values.size() + (sizeInBits + 7) / 8);
+    return m_nextId++;
+}
+
+void CwfWavesFile::endComponent ()
+{
+    assert(m_file);
+    reserve(1);
+    m_data[m_size++] = 'U';
+}
+
+void CwfWavesFile::endSignals ()
+{
+    assert(m_file);
+    writeBlock('H');
+}
+
+void CwfWavesFile::dumpTime (uint64 time)
+{
+    assert(m_file);
+    descore::ScopedSpinLock lock(m_lock);
+
+    // Start a new block if the current one is full
+    if (m_size >= (int) params.WavesBlockSize)
+        writeBlock('D');
+    bool newBlock = !m_size;
+    if (newBlock)
+        m_blockStart = m_lastTime = time;
+
+    reserve(11);
+    m_data[m_size++] = 0;
+    putVarint(time - m_lastTime);
+    m_lastTime = time;
+    if (newBlock)
+        writeSnapshot();
+}
+
+void CwfWavesFile::dumpValue (uint32 id, const byte *value, bool undefined, int sizeInBits)
+{
+    assert(m_file);
+    assert(id);
+
+    int numBytes = (sizeInBits + 7) / 8;
+    descore::ScopedSpinLock lock(m_lock);
+    reserve(numBytes + 5);
+    if (!m_valueState[id])
+        m_numValues++;
+    if (undefined)
+    {
+        putVarint(2 * id + 1);
+        m_valueState[id] = 2;
+    }
+    else
+    {
+        putVarint(2 * id);
+        memcpy(m_data + m_size, value, numBytes);
+        m_size += numBytes;
+        if (sizeInBits & 7)
+            m_data[m_size - 1] &= (1 << (sizeInBits & 7)) - 1;
+        memcpy(&m_values[m_valueOffset[id]], m_data + m_size - numBytes, numBytes);
+        m_valueState[id] = 1;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// CwfReader
+//
+// Sequential reader for cwf files
+//
+////////////////////////////////////////////////////////////////////////////////
+class CwfReader
+{
+public:
+    CwfReader (const char *filename);
+    ~CwfReader ();
+
+    // Read the next block; returns false at the end of the blocks
+    bool readBlock ();
+
+    // Position the reader at the last value change block that starts at or 
+    // before the specified time.  Returns false if the file has no index, 
+    // in which case the blocks must be read in sequence.
+    bool seekTime (uint64 time);
+
+    // Parse the contents of the current block
+    inline bool done () const
+    {
+        return m_pos == (int) m_data.size();
+    }
+    byte getByte ();
+    uint64 getVarint ();
+    string getString ();
+    const byte *getBytes (int numBytes);
+
+public:
+    string m_date;
+    string m_version;
+    string m_timescale;
+    byte   m_type;      // Type of the current block
+    uint64 m_startTime; // Start time of the current block
+
+private:
+    string readString ();
+
+    string m_filename;
+    FILE *m_file;
+    std::vector<byte> m_data;
+    std::vector<byte> m_compressed;
+    int m_pos;
+};
+
+CwfReader::CwfReader (const char *filename) :
+m_type(0),
+m_startTime(0),
+m_filename(filename),
+m_file(fopen(filename, "rb")),
+m_pos(0)
+{
+    assert_always(m_file, "Could not open %s", filename);
+    char magic[8];
+    uint32 version;
+    assert_always((fread(magic, 1, 8, m_file) == 8) && !memcmp(magic, CWF_MAGIC, 8), 
+        "%s is not a cwf waves file", filename);
+    assert_always(read32(m_file, version) && (version == CWF_VERSION), 
+        "%s has unsupported cwf version %u", filename, version);
+    m_date = readString();
+    m_version = readString();
+    m_timescale = readString();
+}
+
+CwfReader::~CwfReader ()
+{
+    fclose(m_file);
+}
+
+string CwfReader::readString ()
+{
+    uint32 len;
+    assert_always(read32(m_file, len) && (len < 0x10000), "Corrupt cwf file header in %s", m_filename.c_str());
+    string ret(len, ' ');
+    assert_always(!len || (fread(&ret[0], 1, len, m_file) == len), "Corrupt cwf file header in %s", m_filename.c_str());
+    return ret;
+}
+
+bool CwfReader::readBlock ()
+{
+    // A missing index means that the file was truncated at a block boundary
+    int type = fgetc(m_file);
+    if ((type == EOF) || (type == 'I'))
+        return false;
+
+    uint64 endTime;
+    uint32 size, compressedSize;
+    bool ok = ((type == 'H') || (type == 'D')) &&
+        read64(m_file, m_startTime) && read64(m_file, endTime) && 
+        read32(m_file, size) && read32(m_file, compressedSize);
+    if (ok)
+    {
+        m_compressed.resize(compressedSize + 1);
+        m_data.resize(size);
+        ok = (fread(&m_compressed[0], 1, compressedSize, m_file) == compressedSize);
+        uLongf destLen = size;
+        ok = ok && (uncompress(size ? &m_data[0] : &m_compressed[0], &destLen, &m_compressed[0], compressedSize) == Z_OK) && (destLen == size);
+    }
+    if (!ok)
+    {
+        // The final block may have been partially written
+        log("Warning: truncated or corrupt cwf block in %s\n", m_filename.c_str());
+        return false;
+    }
+    m_type = (byte) type;
+    m_pos = 0;
+    return true;
+}
+
+bool CwfReader::seekTime (uint64 time)
+{
+    // Trailer
+    long pos = ftell(m_file);
+    uint64 indexOffset;
+    char magic[8];
+    if (fseek(m_file, -16, SEEK_END) || !read64(m_file, indexOffset) || 
+        (fread(magic, 1, 8, m_file) != 8) || memcmp(magic, CWF_END_MAGIC, 8) ||
+        fseek(m_file, (long) indexOffset, SEEK_SET) || (fgetc(m_file) != 'I'))
+    {
+        fseek(m_file, pos, SEEK_SET);
+        return false;
+    }
+
+    // Index
+    uint32 numBlocks;
+    assert_always(read32(m_file, numBlocks), "Corrupt cwf index in %s", m_filename.c_str());
+    uint64 offset = 0;
+    for (uint32 i = 0 ; i < numBlocks ; i++)
+    {
+        uint64 startTime, endTime, blockOffset;
+        assert_always(read64(m_file, startTime) && read64(m_file, endTime) && read64(m_file, blockOffset), 
+            "Corrupt cwf index in %s", m_filename.c_str());
+        if (!i || (startTime <= time))
+            offset = blockOffset;
+    }
+    if (!numBlocks)
+        offset = indexOffset;
+    fseek(m_file, (long) offset, SEEK_SET);
+    return true;
+}
+
+byte CwfReader::getByte ()
+{
+    assert_always(!done(), "Corrupt cwf block in %s", m_filename.c_str());
+    return m_data[m_pos++];
+}
+
+uint64 CwfReader::getVarint ()
+{
+    uint64 ret = 0;
+    for (int shift = 0 ; ; shift += 7)
+    {
+        byte b = getByte();
+        ret |= (uint64) (b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return ret;
+    }
+}
+
+string CwfReader::getString ()
+{
+    int len = (int) getVarint();
+    return string((const char *) getBytes(len), len);
+}
+
+const byte *CwfReader::getBytes (int numBytes)
+{
+    assert_always(m_pos + numBytes <= (int) m_data.size(), "Corrupt cwf block in %s", m_filename.c_str());
+    const byte *ret = &m_data[0] + m_pos;
+    m_pos += numBytes;
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Waves::convertToVcd()
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Write out the current value of every signal that has one
+static void dumpCurrentValues (VcdWavesFile &vcd, 
+                               const std::vector<uint32> &ids, 
+                               const std::vector<int> &sizes, 
+                               const std::vector<uint32> &offsets, 
+                               const std::vector<byte> &values, 
+                               const std::vector<byte> &valueState)
+{
+    for (int id = 1 ; id < (int) sizes.size() ; id++)
+    {
+        if (valueState[id])
+            vcd.dumpValue(ids[id], &values[offsets[id]], valueState[id] == 2, sizes[id]);
+    }
+}
+
+void Waves::convertToVcd (const char *cwfFilename, const char *vcdFilename, uint64 startTime, uint64 endTime)
+{
+    CwfReader reader(cwfFilename);
+    params.WavesTimescale = reader.m_timescale;
+    VcdWavesFile vcd;
+    vcd.open(vcdFilename);
+
+    // Signal hierarchy
+    std::vector<uint32> ids(1, 0);
+    std::vector<int> sizes(1, 0);
+    assert_always(reader.readBlock() && (reader.m_type == 'H'), "Missing signal hierarchy in %s", cwfFilename);
+    while (!reader.done())
+    {
+        byte record = reader.getByte();
+        if (record == 'S')
+            vcd.beginComponent(reader.getString().c_str());
+        else if (record == 'V')
+        {
+            int size = (int) reader.getVarint();
+            ids.push_back(vcd.addSignal(reader.getString().c_str(), size));
+            sizes.push_back(size);
+        }
+        else
+        {
+            assert_always(record == 'U', "Corrupt signal hierarchy in %s", cwfFilename);
+            vcd.endComponent();
+        }
+    }
+    vcd.endSignals();
+
+    // Current value of every signal
+    std::vector<uint32> offsets(1, 0);
+    std::vector<byte> values;
+    for (int i = 1 ; i < (int) sizes.size() ; i++)
+    {
+        offsets.push_back((uint32) values.size());
+        values.resize(values.size() + (sizes[i] + 7) / 8);
+    }
+    std::vector<byte> valueState(sizes.size(), 0); // 0 = no value yet, 1 = defined, 2 = undefined
+
+    // Skip to the start of the time window
+    if (startTime)
+        reader.seekTime(startTime);
+
+    // Value changes.  Changes are only applied to the current values until
+    // the start of the time window is reached, at which point the current 
+    // values are written out.  The window can start at the first time record
+    // of a block, so the current values are written once the snapshot that 
+    // follows it has been read.  Snapshots are only needed to establish the 
+    // current values, so they are not written.
+    bool inWindow = false;
+    bool dumpCurrent = false;
+    int numSnapshot = 0;
+    while (reader.readBlock())
+    {
+        assert_always(reader.m_type == 'D', "Unexpected cwf block type in %s", cwfFilename);
+        uint64 time = reader.m_startTime;
+        while (!reader.done())
+        {
+            uint64 code = reader.getVarint();
+            if (dumpCurrent && !numSnapshot && (code != 1))
+            {
+                dumpCurrent = false;
+                dumpCurrentValues(vcd, ids, sizes, offsets, values, valueState);
+            }
+            if (!code)
+            {
+                time += reader.getVarint();
+                if (time > endTime)
+                    return;
+                if (time >= startTime)
+                {
+                    vcd.dumpTime(time);
+                    if (!inWindow)
+                    {
+                        inWindow = true;
+                        dumpCurrent = true;
+                    }
+                }
+                continue;
+            }
+            if (code == 1)
+            {
+                numSnapshot = (int) reader.getVarint();
+                continue;
+            }
+
+            uint64 id = code >> 1;
+            assert_always(id < ids.size(), "Invalid signal id in %s", cwfFilename);
+            int numBytes = (code & 1) ? 0 : (sizes[id] + 7) / 8;
+            const byte *value = reader.getBytes(numBytes);
+            bool snapshot = (numSnapshot > 0);
+            if (snapshot)
+                numSnapshot--;
+            valueState[id] = (code & 1) ? 2 : 1;
+            memcpy(&values[offsets[id]], value, numBytes);
+            if (inWindow && !snapshot)
+                vcd.dumpValue(ids[id], value, (code & 1) != 0, sizes[id]);
+        }
+    }
+    if (dumpCurrent)
+        dumpCurrentValues(vcd, ids, sizes, offsets, values, valueState);
+}
+
+END_NAMESPACE_CASCADE
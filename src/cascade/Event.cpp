@@ -46,6 +46,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "SimGlobals.hpp"
 #include "SimArchive.hpp"
 #include "Event.hpp"
+#include <descore/MapIterators.hpp>
 
 BEGIN_NAMESPACE_CASCADE
 
@@ -69,6 +70,357 @@ struct CleanupEventTypeTable
 };
 static CleanupEventTypeTable cleanupEventTypeTable;
 
+/////////////////////////////////////////////////////////////////
+//
+// EventPool
+//
+/////////////////////////////////////////////////////////////////
+static const int numEventSizeClasses = EventPool::maxPooledSize / EventPool::granularity;
+static __thread void *t_eventFreeList[numEventSizeClasses];
+static __thread byte *t_eventSlab = NULL;
+static __thread int t_eventSlabRemaining = 0;
+
+void *EventPool::alloc (size_t numBytes)
+{
+    if (numBytes > (size_t) maxPooledSize)
+        return ::operator new(numBytes);
+
+    // Reuse a free event of the same size class
+    int sizeClass = (int) (numBytes - 1) / granularity;
+    void *event = t_eventFreeList[sizeClass];
+    if (event)
+    {
+        t_eventFreeList[sizeClass] = *(void **) event;
+        return event;
+    }
+
+    // Carve a new event out of the current slab.  Slabs are never released,
+    // since their events can end up on the free lists of any thread.
+    int size = (sizeClass + 1) * granularity;
+    if (size > t_eventSlabRemaining)
+    {
+        t_eventSlab = new byte[slabSize];
+        t_eventSlabRemaining = slabSize;
+    }
+    event = t_eventSlab;
+    t_eventSlab += size;
+    t_eventSlabRemaining -= size;
+    return event;
+}
+
+void EventPool::free (void *event, size_t numBytes)
+{
+    if (numBytes > (size_t) maxPooledSize)
+    {
+        ::operator delete(event);
+        return;
+    }
+    int sizeClass = (int) (numBytes - 1) / granularity;
+    *(void **) event = t_eventFreeList[sizeClass];
+    t_eventFreeList[sizeClass] = event;
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// EventWheel()
+//
+/////////////////////////////////////////////////////////////////
+EventWheel::EventWheel () : m_numEvents(0)
+{
+    memset(m_slots, 0, sizeof(m_slots));
+}
+
+EventWheel::~EventWheel ()
+{
+    clear();
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// schedule()
+//
+/////////////////////////////////////////////////////////////////
+void EventWheel::schedule (int now, int tick, IEvent *event)
+{
+    event->m_eventTick = tick;
+    event->m_nextEvent = NULL;
+    m_numEvents++;
+    if (tick - now >= wheelSize)
+        m_overflow.insert(EventMap::value_type(tick, event));
+    else
+    {
+        // Earlier events for the same tick might still be in the overflow map
+        migrate(now);
+        insert(event);
+    }
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// insert()
+//
+/////////////////////////////////////////////////////////////////
+void EventWheel::insert (IEvent *event)
+{
+    Slot &slot = m_slots[event->m_eventTick & (wheelSize - 1)];
+    if (slot.tail)
+        slot.tail->m_nextEvent = event;
+    else
+        slot.head = event;
+    slot.tail = event;
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// migrate()
+//
+/////////////////////////////////////////////////////////////////
+void EventWheel::migrate (int now)
+{
+    while (!m_overflow.empty() && (m_overflow.begin()->first - now < wheelSize))
+    {
+        EventMap::iterator it = m_overflow.begin();
+        insert(it->second);
+        m_overflow.erase(it);
+    }
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// contains()
+//
+/////////////////////////////////////////////////////////////////
+bool EventWheel::contains (int now, int tick, const IEvent *event)
+{
+    migrate(now);
+    if (tick - now < wheelSize)
+    {
+        for (IEvent *e = m_slots[tick & (wheelSize - 1)].head ; e ; e = e->m_nextEvent)
+        {
+            if ((e->m_eventTick == tick) && event->equals(e))
+                return true;
+        }
+        return false;
+    }
+    for (Iterator<EventMap> it(m_overflow, tick, tick) ; it ; it++)
+    {
+        if (event->equals(*it))
+            return true;
+    }
+    return false;
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// fireEventsInternal()
+//
+/////////////////////////////////////////////////////////////////
+void EventWheel::fireEventsInternal (int now)
+{
+    migrate(now);
+    Slot &slot = m_slots[now & (wheelSize - 1)];
+    IEvent *event = slot.head;
+    slot.head = slot.tail = NULL;
+    while (event)
+    {
+        assert(event->m_eventTick == now, "Event scheduled for tick %d was not fired", event->m_eventTick);
+        IEvent *next = event->m_nextEvent;
+        m_numEvents--;
+        event->fireEvent();
+        delete event;
+        event = next;
+    }
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// clear()
+//
+/////////////////////////////////////////////////////////////////
+void EventWheel::clear ()
+{
+    for (int i = 0 ; i < wheelSize ; i++)
+    {
+        IEvent *event = m_slots[i].head;
+        while (event)
+        {
+            IEvent *next = event->m_nextEvent;
+            delete event;
+            event = next;
+        }
+        m_slots[i].head = m_slots[i].tail = NULL;
+    }
+    for_map_values (IEvent *event, m_overflow)
+        delete event;
+    m_overflow.clear();
+    m_numEvents = 0;
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// archive()
+//
+/////////////////////////////////////////////////////////////////
+void EventWheel::archive (Archive &ar, int now)
+{
+    int size = m_numEvents;
+    ar | size;
+    if (ar.isLoading())
+    {
+        clear();
+        for (int i = 0 ; i < size ; i++)
+        {
+            int tick;
+            IEvent *event;
+            ar | tick | event;
+            schedule(now, tick, event);
+        }
+    }
+    else
+    {
+        // Events in tick order, then in the order in which they were scheduled
+        migrate(now);
+        for (int tick = now ; tick < now + wheelSize ; tick++)
+        {
+            for (IEvent *event = m_slots[tick & (wheelSize - 1)].head ; event ; event = event->m_nextEvent)
+                ar | tick | event;
+        }
+        for (EventMap::iterator it = m_overflow.begin() ; it != m_overflow.end() ; it++)
+        {
+            int tick = it->first;
+            ar | tick | it->second;
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// TimedEventQueue()
+//
+/////////////////////////////////////////////////////////////////
+TimedEventQueue::TimedEventQueue () : m_numEvents(0)
+{
+}
+
+TimedEventQueue::~TimedEventQueue ()
+{
+    clear();
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// schedule()
+//
+/////////////////////////////////////////////////////////////////
+void TimedEventQueue::schedule (uint64 time, IEvent *event)
+{
+    event->m_nextEvent = NULL;
+    BatchMap::iterator it = m_batches.find(time);
+    if (it == m_batches.end())
+    {
+        Batch &batch = m_batches[time];
+        batch.head = batch.tail = event;
+    }
+    else
+    {
+        it->second.tail->m_nextEvent = event;
+        it->second.tail = event;
+    }
+    m_numEvents++;
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// contains()
+//
+/////////////////////////////////////////////////////////////////
+bool TimedEventQueue::contains (uint64 time, const IEvent *event) const
+{
+    BatchMap::const_iterator it = m_batches.find(time);
+    if (it == m_batches.end())
+        return false;
+    for (IEvent *e = it->second.head ; e ; e = e->m_nextEvent)
+    {
+        if (event->equals(e))
+            return true;
+    }
+    return false;
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// fireEvents()
+//
+/////////////////////////////////////////////////////////////////
+void TimedEventQueue::fireEvents ()
+{
+    // Remove the batch before firing it, since the events may schedule
+    // more events
+    BatchMap::iterator it = m_batches.begin();
+    IEvent *event = it->second.head;
+    m_batches.erase(it);
+    while (event)
+    {
+        IEvent *next = event->m_nextEvent;
+        m_numEvents--;
+        event->fireEvent();
+        delete event;
+        event = next;
+    }
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// clear()
+//
+/////////////////////////////////////////////////////////////////
+void TimedEventQueue::clear ()
+{
+    for_map_values (const Batch &batch, m_batches)
+    {
+        IEvent *event = batch.head;
+        while (event)
+        {
+            IEvent *next = event->m_nextEvent;
+            delete event;
+            event = next;
+        }
+    }
+    m_batches.clear();
+    m_numEvents = 0;
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// archive()
+//
+/////////////////////////////////////////////////////////////////
+void TimedEventQueue::archive (Archive &ar)
+{
+    int size = m_numEvents;
+    ar | size;
+    if (ar.isLoading())
+    {
+        clear();
+        for (int i = 0 ; i < size ; i++)
+        {
+            uint64 time;
+            IEvent *event;
+            ar | time | event;
+            schedule(time, event);
+        }
+    }
+    else
+    {
+        for (BatchMap::iterator it = m_batches.begin() ; it != m_batches.end() ; it++)
+        {
+            uint64 time = it->first;
+            for (IEvent *event = it->second.head ; event ; event = event->m_nextEvent)
+                ar | time | event;
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // equals()
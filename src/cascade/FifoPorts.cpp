@@ -50,12 +50,21 @@ BEGIN_NAMESPACE_CASCADE
 
 FifoBitbucketTarget fifoBitbucketTarget;
 
-// gcc has problems with offsetof in a static assertion
-#ifdef _MSC_VER
-#define FIFO_STATIC_ASSERT STATIC_ASSERT
-#else
-#define FIFO_STATIC_ASSERT assert_always
-#endif
+/////////////////////////////////////////////////////////////////
+//
+// getFifoScratch()
+//
+// Fifo entries are smaller than CASCADE_MAX_PORT_SIZE bits (this is 
+// checked by the FifoPort constructor), so fixed per-thread storage 
+// always suffices and there is nothing to free when a thread exits.
+//
+/////////////////////////////////////////////////////////////////
+static __thread uint64 t_fifoScratch[CASCADE_MAX_PORT_SIZE / 64];
+
+byte *getFifoScratch ()
+{
+    return (byte *) t_fifoScratch;
+}
 
 /////////////////////////////////////////////////////////////////
 //
@@ -68,7 +77,9 @@ void GenericFifo::initialize (unsigned _dataSize,
                               bool _noflow,
                               intptr_t _target,
                               ClockDomain *producer,
-                              ClockDomain *consumer)
+                              ClockDomain *consumer,
+                              byte *_data,
+                              FifoLinks *_links)
 {
     CascadeValidate(_size <= CASCADE_MAX_FIFO_SIZE, "Fifo size (%d) out of bounds", _size);
     CascadeValidate(_delay <= CASCADE_MAX_FIFO_DELAY, "Fifo delay (%d) out of bounds", _delay);
@@ -76,10 +87,6 @@ void GenericFifo::initialize (unsigned _dataSize,
     CascadeValidate((_size % _dataSize) == 0, "Fifo storage size is not a multiple of the data size");
     CascadeValidate(!_delay || _size || !_target, "Fifo has delay but zero size and a trigger");
 
-    FIFO_STATIC_ASSERT(descore_offsetof(Fifo<byte>,   data) == sizeof(GenericFifo));
-    FIFO_STATIC_ASSERT(descore_offsetof(Fifo<uint64>, data) == sizeof(GenericFifo));
-    FIFO_STATIC_ASSERT(descore_offsetof(Fifo<u128>,   data) == sizeof(GenericFifo));
-
     Sim::updateChecksum("FifoSize", _size);
     head = 0;
     tail = 0;
@@ -88,11 +95,16 @@ void GenericFifo::initialize (unsigned _dataSize,
     size = _size;
     dataSize = _dataSize;
     minFree = freeCount;
+    numPushes = 0;
     delay = _delay;
     noflow = _noflow ? 1 : 0;
+    data = _data;
     target = _target;
-    producerClockDomain = producer;
-    consumerClockDomain = consumer;
+    links = _links;
+    links->producerClockDomain = producer;
+    links->consumerClockDomain = consumer;
+    links->pending = NULL;
+    links->channel = NULL;
 }
 
 /////////////////////////////////////////////////////////////////
@@ -116,8 +128,6 @@ void GenericFifo::reset ()
 /////////////////////////////////////////////////////////////////
 void GenericFifo::archive (Archive &ar)
 {
-    byte *data = GENERIC_FIFO_DATA(this);
-
     ar | head | tail | freeCount | fullCount | minFree;
     ar.archiveData(data, size);
 }
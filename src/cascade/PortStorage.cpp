@@ -50,7 +50,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "FifoPorts.hpp"
 #include "PortStorage.hpp"
 #include "ClockDomain.hpp"
+#include "SimMemory.hpp"
 #include <descore/MapIterators.hpp>
+#include <algorithm>
 
 BEGIN_NAMESPACE_CASCADE
 
@@ -61,6 +63,15 @@ BEGIN_NAMESPACE_CASCADE
 ////////////////////////////////////////////////////////////////////////////////
 PortStorage::PortStorage () : 
 m_fifoData(NULL),
+m_largeFifoData(NULL),
+m_largeFifoDataSize(0),
+m_fifoLinks(NULL),
+m_fifoPending(NULL),
+m_channelData(NULL),
+m_fifoChannels(NULL),
+m_numFifoChannels(0),
+m_fifoStats(NULL),
+m_numFifoStats(0),
 m_portData(NULL),
 m_pulsePorts(NULL),
 m_delayOffset(NULL)
@@ -74,8 +85,13 @@ m_delayOffset(NULL)
 ////////////////////////////////////////////////////////////////////////////////
 PortStorage::~PortStorage ()
 {
-    delete[] m_fifoData;
-    delete[] m_portData;
+    freeSimMemory(m_fifoData, m_fifoDataSize);
+    freeSimMemory(m_largeFifoData, m_largeFifoDataSize);
+    freeSimMemory(m_portData, m_portBytes);
+    delete[] m_fifoLinks;
+    delete[] m_fifoPending;
+    delete[] m_channelData;
+    delete[] m_fifoStats;
     delete[] m_delayOffset;
 }
 
@@ -165,18 +181,35 @@ void PortStorage::initPorts (ClockDomain *domain)
             m_maxDelay = p->delay;
     }
 
-    // Sort terminal ports by (P/NL, delay, N/L, size)
+    // Find the first reader of each terminal port (before m_terminalPorts is emptied)
+    ReaderMap firstReader;
+    if (params.PortLocality)
+        getFirstReaders(firstReader);
+
+    // Sort terminal ports by (P/NL, delay, N/L, size).  Ports of arrays
+    // whose triggers are coalesced are sorted after all other sizes so that the 
+    // arrays are contiguous.
     PortMap sortedTerminalPorts;
     PortMap sortedPulsePorts;
     for (PortList::Remover it = m_terminalPorts ; it ; it++)
     {
         PortWrapper *p = *it;
+        int size = p->coalesce ? (0x8000 | p->size) : p->size;
         if (p->type == PORT_PULSE)
-            sortedPulsePorts[(~p->delay << 17) | p->size].addPort(p);
+            sortedPulsePorts[(~p->delay << 17) | size].addPort(p);
         else if (p->type == PORT_LATCH)
-            sortedTerminalPorts[(p->delay << 17) | 0x10000 | p->size].addPort(p);
+            sortedTerminalPorts[(p->delay << 17) | 0x10000 | size].addPort(p);
         else
-            sortedTerminalPorts[(p->delay << 17) | p->size].addPort(p);
+            sortedTerminalPorts[(p->delay << 17) | size].addPort(p);
+    }
+
+    // Within each block, place ports that are read by the same update function together
+    if (params.PortLocality)
+    {
+        for (PortMap::iterator it = sortedTerminalPorts.begin() ; it != sortedTerminalPorts.end() ; it++)
+            sortByReader(it->second, firstReader);
+        for (PortMap::iterator it = sortedPulsePorts.begin() ; it != sortedPulsePorts.end() ; it++)
+            sortByReader(it->second, firstReader);
     }
 
     // Compute storage requirements for terminal ports
@@ -225,7 +258,7 @@ void PortStorage::initPorts (ClockDomain *domain)
     Sim::stats.numRegisterBytes += m_portBytes - portBytes[0];
 
     // Allocate values and initialize nports (for port invalidation)
-    m_portData = new byte[m_portBytes];
+    m_portData = allocSimMemory(m_portBytes);
     m_pulsePorts = m_portData + normalBytes;
     allocateValues(sortedTerminalPorts, ndepthOffset, nsize, m_portData);
     allocateValues(sortedPulsePorts, pdepthOffset, NULL, m_pulsePorts);
@@ -292,6 +325,72 @@ void PortStorage::initPorts (ClockDomain *domain)
     delete[] portBytes;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// getFirstReaders()
+//
+// For each terminal port, determine the index of the first update function
+// that reads the port, either directly or through a synchronous connection.
+//
+////////////////////////////////////////////////////////////////////////////////
+void PortStorage::updateFirstReader (ReaderMap &firstReader, const PortWrapper *terminal, const PortWrapper *p)
+{
+    for (int i = 0 ; i < p->readers.size() ; i++)
+    {
+        int index = p->readers[i]->index;
+        ReaderMap::iterator it = firstReader.find(terminal);
+        if (it == firstReader.end())
+            firstReader[terminal] = index;
+        else if (index < it->second)
+            it->second = index;
+    }
+}
+
+void PortStorage::getFirstReaders (ReaderMap &firstReader) const
+{
+    for (PortWrapper *p = m_terminalPorts.first() ; p ; p = p->next)
+        updateFirstReader(firstReader, p, p);
+    for (PortWrapper *p = m_synchronousPorts.first() ; p ; p = p->next)
+        updateFirstReader(firstReader, p->connectedTo, p);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// sortByReader()
+//
+// Reorder a list of ports from a single storage block so that ports read 
+// by the same update function are adjacent, and the groups appear in 
+// update order.  This improves cache locality when the update functions
+// are called in order.  Ports that aren't read by any update function
+// are placed at the end of the list in their original order.  Port arrays
+// whose triggers are coalesced are left as-is so that they remain contiguous.
+//
+////////////////////////////////////////////////////////////////////////////////
+typedef std::pair<int, PortWrapper *> ReaderPort;
+
+static bool compareReaderPorts (const ReaderPort &lhs, const ReaderPort &rhs)
+{
+    return lhs.first < rhs.first;
+}
+
+void PortStorage::sortByReader (PortList &ports, const ReaderMap &firstReader)
+{
+    if (!ports.first() || ports.first()->coalesce)
+        return;
+
+    std::vector<ReaderPort> sorted;
+    for (PortWrapper *p = ports.first() ; p ; p = p->next)
+    {
+        ReaderMap::const_iterator it = firstReader.find(p);
+        sorted.push_back(ReaderPort((it == firstReader.end()) ? 0x7fffffff : it->second, p));
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), compareReaderPorts);
+
+    ports.reset();
+    for (unsigned i = 0 ; i < sorted.size() ; i++)
+        ports.addPort(sorted[i].second);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // allocateValues()
@@ -376,6 +475,14 @@ int PortStorage::allocateValues (const PortMap &ports, int *depthOffset, int *ns
     return (offset + 3) & ~3;
 }
 
+// Number of bytes occupied in m_fifoData by a fifo with the given storage size
+static inline int fifoBlockSize (unsigned storageSize)
+{
+    if (storageSize > CASCADE_MAX_INLINE_FIFO_SIZE)
+        storageSize = 0;
+    return (sizeof(GenericFifo) + storageSize + 7) & ~7;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // initFifos()
@@ -383,8 +490,10 @@ int PortStorage::allocateValues (const PortMap &ports, int *depthOffset, int *ns
 ////////////////////////////////////////////////////////////////////////////////
 void PortStorage::initFifos (ClockDomain *domain)
 {
-    // Allocate fifo storage
+    // Allocate fifo storage.  Small fifos are stored inline following their
+    // GenericFifo; large fifos are allocated in a separate arena.
     m_fifoDataSize = 0;
+    m_largeFifoDataSize = 0;
     m_numFifos = 0;
     for (PortWrapper *p = m_fifoPorts.first() ; p ; p = p->next, m_numFifos++)
     {
@@ -392,22 +501,40 @@ void PortStorage::initFifos (ClockDomain *domain)
             p->fifoSize = 0;
         if (p->connection != FIFO_NORMAL)
             p->delay = 0;
-        m_fifoDataSize += sizeof(GenericFifo) + p->size * p->fifoSize;
-        m_fifoDataSize = (m_fifoDataSize + 3) & ~3;
+        unsigned storageSize = p->size * p->fifoSize;
+        m_fifoDataSize += fifoBlockSize(storageSize);
+        if (storageSize > CASCADE_MAX_INLINE_FIFO_SIZE)
+            m_largeFifoDataSize += (storageSize + 7) & ~7;
     }
 
-    m_fifoData = new byte[m_fifoDataSize];
+    m_fifoData = allocSimMemory(m_fifoDataSize);
     memset(m_fifoData, 0, m_fifoDataSize);
     Sim::stats.numFifoBytes += m_fifoDataSize;
+    if (m_largeFifoDataSize)
+    {
+        m_largeFifoData = allocSimMemory(m_largeFifoDataSize);
+        memset(m_largeFifoData, 0, m_largeFifoDataSize);
+        Sim::stats.numFifoBytes += m_largeFifoDataSize;
+    }
+
+    m_fifoLinks = new FifoLinks[m_numFifos];
 
     // Initialize the fifos
     int offset = 0;
+    int64 largeOffset = 0;
+    FifoLinks *links = m_fifoLinks;
     for (PortWrapper *p = m_fifoPorts.first() ; p ; p = p->next)
     {
-        // Get the current fifo pointer and update offset
+        // Get the current fifo pointer and storage, and update the offsets
         GenericFifo *currFifo = (GenericFifo *) (m_fifoData + offset);
-        offset += sizeof(GenericFifo) + p->size * p->fifoSize;
-        offset = (offset + 3) & ~3;
+        unsigned storageSize = p->size * p->fifoSize;
+        offset += fifoBlockSize(storageSize);
+        byte *data = (byte *) (currFifo + 1);
+        if (storageSize > CASCADE_MAX_INLINE_FIFO_SIZE)
+        {
+            data = m_largeFifoData + largeOffset;
+            largeOffset += (storageSize + 7) & ~7;
+        }
         p->fifo->fifo = (Fifo<byte> *) currFifo;
 
         // Resolve the target
@@ -434,8 +561,12 @@ void PortStorage::initFifos (ClockDomain *domain)
         }
 
         // Initialize the fifo
-        currFifo->initialize(p->size, p->size * p->fifoSize, p->delay, 
-            p->fifoDisableFlowControl, target, producer, domain);
+        currFifo->initialize(p->size, storageSize, p->delay, 
+            p->fifoDisableFlowControl, target, producer, domain, data, links);
+        links->port = p->fifo;
+        links->consumer = (p->readers.size() && !p->triggers.size()) ? (Component *) target : NULL;
+        links->minSize = p->fifoMinSize;
+        links++;
 
         // Check to see if we need to increase the sync depth
         if ((int) p->delay > domain->m_syncDepth)
@@ -447,6 +578,94 @@ void PortStorage::initFifos (ClockDomain *domain)
 #endif
     }
     CascadeValidate(offset == m_fifoDataSize, "Fifo data size mismatch");
+    CascadeValidate(largeOffset == m_largeFifoDataSize, "Large fifo data size mismatch");
+    if (params.FifoStats)
+        initFifoStats();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// initFifoStats()
+//
+// Set up the statistics of the fifos with storage.  Called during
+// initialization if cascade.FifoStats is set, or by the clock domain
+// the first time it sees cascade.FifoStats set at runtime.
+//
+////////////////////////////////////////////////////////////////////////////////
+void PortStorage::initFifoStats ()
+{
+    m_fifoStats = new FifoStatsEntry[m_numFifos];
+    int offset = 0;
+    for (int i = 0 ; i < m_numFifos ; i++)
+    {
+        GenericFifo *fifo = (GenericFifo *) (m_fifoData + offset);
+        offset += fifoBlockSize(fifo->size);
+        if (fifo->size)
+        {
+            FifoStatsEntry &entry = m_fifoStats[m_numFifoStats++];
+            entry.fifo = fifo;
+            entry.port = fifo->links->port;
+            entry.consumer = fifo->links->consumer;
+            entry.minSize = fifo->links->minSize;
+        }
+    }
+    resetFifoStats();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// initDelayedFifos()
+//
+////////////////////////////////////////////////////////////////////////////////
+void PortStorage::initDelayedFifos (int syncDepth)
+{
+    // Each fifo with delay gets a ring of pending push/pop counts indexed
+    // by the sync slot of the consumer clock domain.  Fifos pushed from another
+    // clock domain additionally get a channel so that the producer never
+    // touches the consumer's sync slots.
+    int numDelayed = 0;
+    for (int offset = 0 ; offset < m_fifoDataSize ; )
+    {
+        GenericFifo *fifo = (GenericFifo *) (m_fifoData + offset);
+        offset += fifoBlockSize(fifo->size);
+        if (fifo->delay)
+        {
+            numDelayed++;
+            if (fifo->links->producerClockDomain && (fifo->links->producerClockDomain != fifo->links->consumerClockDomain))
+                m_numFifoChannels++;
+        }
+    }
+    if (!numDelayed)
+        return;
+
+    m_fifoPending = new FifoPending[numDelayed * syncDepth];
+    memset(m_fifoPending, 0, numDelayed * syncDepth * sizeof(FifoPending));
+    if (m_numFifoChannels)
+    {
+        m_channelData = new byte[(m_numFifoChannels + 1) * sizeof(FifoChannel)];
+        intptr_t aligned = ((intptr_t) m_channelData + FIFO_CACHE_LINE_SIZE - 1) & ~(intptr_t) (FIFO_CACHE_LINE_SIZE - 1);
+        m_fifoChannels = (FifoChannel *) aligned;
+        memset(m_fifoChannels, 0, m_numFifoChannels * sizeof(FifoChannel));
+    }
+
+    FifoPending *pending = m_fifoPending;
+    FifoChannel *channel = m_fifoChannels;
+    for (int offset = 0 ; offset < m_fifoDataSize ; )
+    {
+        GenericFifo *fifo = (GenericFifo *) (m_fifoData + offset);
+        offset += fifoBlockSize(fifo->size);
+        if (fifo->delay)
+        {
+            FifoLinks *links = fifo->links;
+            links->pending = pending;
+            pending += syncDepth;
+            if (links->producerClockDomain && (links->producerClockDomain != links->consumerClockDomain))
+            {
+                channel->fifo = fifo;
+                links->channel = channel++;
+            }
+        }
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -618,15 +837,14 @@ void PortStorage::archive (Archive &ar)
     // then temporarily record the number of in-flight pushes in fullCount, then copy 
     // this information to the WavesFifos, then archive the actual Fifo data.  The first
     // step (here) is to set the full counts to zero, then we'll iterate over
-    // m_syncFifoPush in ClockDomain to tally up the proper full counts.
+    // m_syncFifos in ClockDomain to tally up the proper full counts.
     if (ar.isLoading())
     {
         // Set the full counts to zero
         for (int offset = 0 ; offset < m_fifoDataSize ; )
         {
             GenericFifo *fifo = (GenericFifo *) (m_fifoData + offset);
-            offset += sizeof(GenericFifo) + fifo->size;
-            offset = (offset + 3) & ~3;
+            offset += fifoBlockSize(fifo->size);
             fifo->fullCount = 0;
         }
     }
@@ -642,16 +860,21 @@ void PortStorage::archvieFifos (Archive &ar)
     int numFifos = m_numFifos;
     ar | numFifos;
     assert_always(numFifos == m_numFifos, "Archive contains invalid number of fifos");
-    int expectedDataSize = m_fifoDataSize - m_numFifos * sizeof(GenericFifo);
-    int fifoDataSize = expectedDataSize;
+    int64 expectedDataSize = 0;
+    for (int offset = 0 ; offset < m_fifoDataSize ; )
+    {
+        GenericFifo *fifo = (GenericFifo *) (m_fifoData + offset);
+        offset += fifoBlockSize(fifo->size);
+        expectedDataSize += fifo->size;
+    }
+    int64 fifoDataSize = expectedDataSize;
     ar | fifoDataSize;
     assert(fifoDataSize == expectedDataSize, "Archive contains invalid fifo data.\n"
         "    Have you changed fifo sizes since the archive was created?");
     for (int offset = 0 ; offset < m_fifoDataSize ; )
     {
         GenericFifo *fifo = (GenericFifo *) (m_fifoData + offset);
-        offset += sizeof(GenericFifo) + fifo->size;
-        offset = (offset + 3) & ~3;
+        offset += fifoBlockSize(fifo->size);
         fifo->archive(ar);
     }
 }
@@ -661,28 +884,52 @@ void PortStorage::archvieFifos (Archive &ar)
 // archiveFifoStack()
 //
 /////////////////////////////////////////////////////////////////
-void PortStorage::archiveFifoStack (Archive &ar, stack<GenericFifo *> &v)
+void PortStorage::archiveFifoStack (Archive &ar, stack<GenericFifo *> &v, int slot)
 {
+    // Pending pushes followed by pending pops, archived as one fifo offset
+    // per entry so that the archive doesn't depend on how they were counted.
     if (ar.isLoading())
     {
-        int size;
-        ar | size;
-        v.resize(size);
-        for (int i = 0 ; i < size ; i++)
+        for (int i = 0 ; i < v.size() ; i++)
+        {
+            v[i]->links->pending[slot].push = 0;
+            v[i]->links->pending[slot].pop = 0;
+        }
+        v.clear();
+        for (int pop = 0 ; pop < 2 ; pop++)
         {
-            int offset;
-            ar | offset;
-            v[i] = (GenericFifo *) (m_fifoData + offset);
+            int size;
+            ar | size;
+            for (int i = 0 ; i < size ; i++)
+            {
+                int offset;
+                ar | offset;
+                GenericFifo *fifo = (GenericFifo *) (m_fifoData + offset);
+                FifoPending &pending = fifo->links->pending[slot];
+                if (!(pending.push | pending.pop))
+                    v.push(fifo);
+                if (pop)
+                    pending.pop++;
+                else
+                    pending.push++;
+            }
         }
     }
     else
     {
-        int size = v.size();
-        ar | size;
-        for (int i = 0 ; i < size ; i++)
+        for (int pop = 0 ; pop < 2 ; pop++)
         {
-            int offset = ((byte *) v[i]) - m_fifoData;
-            ar | offset;
+            int size = 0;
+            for (int i = 0 ; i < v.size() ; i++)
+                size += pop ? v[i]->links->pending[slot].pop : v[i]->links->pending[slot].push;
+            ar | size;
+            for (int i = 0 ; i < v.size() ; i++)
+            {
+                int offset = ((byte *) v[i]) - m_fifoData;
+                int count = pop ? v[i]->links->pending[slot].pop : v[i]->links->pending[slot].push;
+                for (int j = 0 ; j < count ; j++)
+                    ar | offset;
+            }
         }
     }
 }
@@ -697,8 +944,7 @@ void PortStorage::checkDeadlock ()
     for (int offset = 0 ; offset < m_fifoDataSize ; )
     {
         GenericFifo *fifo = (GenericFifo *) (m_fifoData + offset);
-        offset += sizeof(GenericFifo) + fifo->size;
-        offset = (offset + 3) & ~3;
+        offset += fifoBlockSize(fifo->size);
 
         if (!(fifo->target & TRIGGER_ITRIGGER) && fifo->size)
         {
@@ -710,4 +956,103 @@ void PortStorage::checkDeadlock ()
     }
 }
 
+/////////////////////////////////////////////////////////////////
+//
+// sampleFifoStarvation()
+//
+// Record which fifos are empty before the updates are called.  A
+// consumer that deactivates itself whenever its input is empty is
+// only woken up by a push, so starvation is judged by whether any 
+// entries were available during the cycle rather than by whether the 
+// consumer is active.
+//
+/////////////////////////////////////////////////////////////////
+void PortStorage::sampleFifoStarvation ()
+{
+    for (int i = 0 ; i < m_numFifoStats ; i++)
+    {
+        FifoStatsEntry &entry = m_fifoStats[i];
+        entry.emptyAtUpdate = !entry.fifo->fullCount;
+        entry.updatePushes = entry.fifo->numPushes;
+    }
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// sampleFifoStats()
+//
+/////////////////////////////////////////////////////////////////
+void PortStorage::sampleFifoStats ()
+{
+    if (Sim::state != Sim::SimInitialized)
+        return;
+
+    for (int i = 0 ; i < m_numFifoStats ; i++)
+    {
+        FifoStatsEntry &entry = m_fifoStats[i];
+        const GenericFifo *fifo = entry.fifo;
+        FifoStats &stats = entry.stats;
+
+        int occupancy = stats.capacity - fifo->freeCount;
+        stats.cycles++;
+        stats.pushes += (uint32) (fifo->numPushes - entry.numPushes);
+        entry.numPushes = fifo->numPushes;
+        stats.occupancySum += occupancy;
+        if (occupancy > stats.maxOccupancy)
+            stats.maxOccupancy = occupancy;
+        stats.histogram[((int64) occupancy * (FIFO_STATS_BUCKETS - 1) + stats.capacity - 1) / stats.capacity]++;
+        if (!fifo->freeCount)
+            stats.fullCycles++;
+
+        // Entries pushed during the updates are only visible to the consumer
+        // on the same cycle if the fifo has no delay
+        if (entry.consumer && entry.emptyAtUpdate && (fifo->delay || fifo->numPushes == entry.updatePushes))
+            stats.starvedCycles++;
+        entry.emptyAtUpdate = false;
+    }
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// resetFifoStats()
+//
+/////////////////////////////////////////////////////////////////
+void PortStorage::resetFifoStats ()
+{
+    for (int i = 0 ; i < m_numFifoStats ; i++)
+    {
+        FifoStatsEntry &entry = m_fifoStats[i];
+        FifoStats &stats = entry.stats;
+        entry.numPushes = entry.fifo->numPushes;
+        entry.emptyAtUpdate = false;
+        entry.fifo->minFree = entry.fifo->freeCount;
+        stats.capacity = entry.fifo->size / entry.fifo->dataSize;
+        stats.cycles = 0;
+        stats.pushes = 0;
+        stats.fullCycles = 0;
+        stats.starvedCycles = 0;
+        stats.occupancySum = 0;
+        stats.maxOccupancy = 0;
+        memset(stats.histogram, 0, sizeof(stats.histogram));
+    }
+}
+
+/////////////////////////////////////////////////////////////////
+//
+// getFifoStats()
+//
+/////////////////////////////////////////////////////////////////
+void PortStorage::getFifoStats (std::vector<FifoStats> &stats) const
+{
+    for (int i = 0 ; i < m_numFifoStats ; i++)
+    {
+        const FifoStatsEntry &entry = m_fifoStats[i];
+        stats.push_back(entry.stats);
+        FifoStats &s = stats.back();
+        s.name = *entry.port->getName();
+        s.highWaterMark = s.capacity - entry.fifo->minFree;
+        s.minSize = entry.minSize;
+    }
+}
+
 END_NAMESPACE_CASCADE
@@ -85,7 +85,10 @@ fifoDisableFlowControl(0),
 mark(0),
 verilog_wr(0),
 verilog_rd(0),
+coalesce(0),
+coalesceRun(1),
 fifoSize(0),
+fifoMinSize(0),
 delay(0),
 parent(_port ? Hierarchy::getComponent() : NULL),
 next(NULL),
@@ -303,6 +306,37 @@ int PortWrapper::getFifoClockPeriod (int defaultPeriod) const
     return defaultPeriod;
 }
 
+/////////////////////////////////////////////////////////////////
+//
+// loadFifoSizes()
+//
+// Read the suggested sizes from a fifo sizing report written by
+// Sim::writeFifoSizingReport().  Each non-comment line has the form
+// '<fifo> <size> <suggested size>'.
+//
+/////////////////////////////////////////////////////////////////
+static std::map<string, int> g_fifoSizes;
+
+static void loadFifoSizes (const char *filename)
+{
+    g_fifoSizes.clear();
+    if (!*filename)
+        return;
+
+    FILE *f = fopen(filename, "r");
+    assert_always(f, "Could not open fifo sizing report %s", filename);
+    char line[4096];
+    char name[4096];
+    while (fgets(line, sizeof(line), f))
+    {
+        int size, suggested;
+        if ((line[0] != '#') && (sscanf(line, "%4095s %d %d", name, &size, &suggested) == 3))
+            g_fifoSizes[name] = suggested;
+    }
+    fclose(f);
+    logInfo("Read %d fifo sizes from %s\n", (int) g_fifoSizes.size(), filename);
+}
+
 /////////////////////////////////////////////////////////////////
 //
 // resolveFifo()
@@ -367,6 +401,19 @@ void PortWrapper::resolveFifo ()
         minSize = 2 * totalDelay * consumerClockPeriod / producerClockPeriod + 1;
     }
     
+    // A size from a fifo sizing report (cascade.FifoSizes) replaces the constructed 
+    // size.  It is known to sustain the recorded workload, so don't warn about it.
+    bool reportedSize = false;
+    if (!g_fifoSizes.empty())
+    {
+        std::map<string, int>::const_iterator it = g_fifoSizes.find(*producer->getName());
+        if (it != g_fifoSizes.end())
+        {
+            totalSize = it->second;
+            reportedSize = true;
+        }
+    }
+
     // If the fifo size is zero, then automatically size it to minSize.  Otherwise,
     // make sure that the size is at least minSize.  If it's not, generate a warning
     // if flow control is enabled, and an error if flow control is disabled.
@@ -376,7 +423,7 @@ void PortWrapper::resolveFifo ()
     {
         if (disableFlowControl)
             die("Fifo size must be at least %d to accomodate the specified delay", minSize);
-        else if (params.FifoSizeWarnings)
+        else if (params.FifoSizeWarnings && !reportedSize)
         {
             log("Warning: Fifo %s with size %d must have size at least %d\n"
                 "         to achieve full throughput with the specified delay\n",
@@ -386,9 +433,10 @@ void PortWrapper::resolveFifo ()
 
     // Set the delay and size of the producer fifo and reparent it under the consumer
     assert_always(totalDelay < CASCADE_MAX_FIFO_DELAY, "Fifo delay (%d) exceeds maximum of %d", totalDelay, CASCADE_MAX_FIFO_DELAY);
-    assert_always(totalSize * size < CASCADE_MAX_FIFO_SIZE, "Fifo size in bytes (%d) exceeds maximum of %d", size, CASCADE_MAX_FIFO_SIZE);
+    assert_always((int64) totalSize * size <= CASCADE_MAX_FIFO_SIZE, "Fifo size (%d entries of %d bytes) exceeds maximum of %d bytes", totalSize, (int) size, CASCADE_MAX_FIFO_SIZE);
     producer->delay = totalDelay;
     producer->fifoSize = totalSize;
+    producer->fifoMinSize = disableFlowControl ? minSize : 1;
     producer->fifoDisableFlowControl = disableFlowControl;
     if (producer != this)
     {
@@ -570,6 +618,19 @@ void PortWrapper::resolveNetlists ()
 {
     logInfo("Resolving port netlists...\n");
 
+    // Mark the elements of single-byte port arrays for trigger coalescing
+    if (params.CoalesceArrayTriggers)
+    {
+        for (PortWrapper *w = g_ports.first() ; w ; w = w->next)
+        {
+            if (w->next && w->next->arrayInternal && (w->size == 1) && !w->isFifo())
+                w->coalesce = w->next->coalesce = 1;
+        }
+    }
+
+    // Fifo sizes from a sizing report
+    loadFifoSizes(**params.FifoSizes);
+
     // First pass: resolve connections, readers and writers
     for (PortWrapper *w = g_ports.first() ; w ; w = w->next)
     {
@@ -578,6 +639,7 @@ void PortWrapper::resolveNetlists ()
         else
             w->resolveNet();
     }
+    g_fifoSizes.clear();
 
     // Second pass: sort ports and initialize update graph
     for (PortList::Remover it(g_ports) ; it ; it++)
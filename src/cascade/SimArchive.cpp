@@ -52,6 +52,13 @@ Component *SimArchive::s_component = NULL;
 // Magic number at the end of a simulation archive
 const uint32 ARCHIVE_CHECKVAL = 0xe37adb02;
 
+// Magic number and format version at the start of a simulation archive.
+// Increment the version whenever the archived state changes layout.
+// Version 1 added the timed events, the fifo high water marks and the
+// packed fifo headers; older archives have no header and are rejected.
+const uint32 ARCHIVE_MAGIC = 0x4b435343;
+const uint32 ARCHIVE_VERSION = 1;
+
 // Vector of callbacks
 static std::vector<SimArchive::Callback> s_callbacks;
 
@@ -69,6 +76,16 @@ void SimArchive::archiveSimulation (Archive &ar)
         Sim::init();
     Sim::state = Sim::SimArchiving;
 
+    // Archive the format version
+    uint32 magic = ARCHIVE_MAGIC;
+    uint32 version = ARCHIVE_VERSION;
+    ar | magic;
+    assert_always(magic == ARCHIVE_MAGIC, "Load error: archive has no format version; "
+        "it was written by an older version of Cascade and can't be loaded");
+    ar | version;
+    assert_always(version == ARCHIVE_VERSION, "Load error: archive format version %u is not supported "
+        "(expected version %u)", version, ARCHIVE_VERSION);
+
     // Callbacks
     for (unsigned i = 0 ; i < s_callbacks.size() ; i++)
         (*s_callbacks[i])(ar);
@@ -88,6 +105,9 @@ void SimArchive::archiveSimulation (Archive &ar)
     // Archive the clock domains (also archives all ports)
     Cascade::ClockDomain::archiveClockDomains(ar);
 
+    // Archive the events scheduled for an absolute time
+    Cascade::ClockDomain::archiveTimedEvents(ar);
+
     // Archive the components
     Sim::doComponents(archiveComponent);
 
@@ -49,9 +49,18 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <descore/Statistics.hpp>
 #include <descore/crc.hpp>
 #include <descore/Wildcard.hpp>
+#include <descore/PrintTable.hpp>
+#include <algorithm>
 #include "Clock.hpp"
 #include "Verilog.hpp"
 #include "Waves.hpp"
+#include "SimMemory.hpp"
+
+#ifdef _MSC_VER
+#include <io.h>
+#else
+#include <dirent.h>
+#endif
 
 using namespace Cascade;
 
@@ -132,9 +141,12 @@ void CascadeStats::Dump ()
     DUMP_STAT64(numUpdateBytes);
     DUMP_STAT64(numRegisterBytes);
     DUMP_STAT64(numFakeRegisterBytes);
+    DUMP_STAT64(numHugePageBytes);
     log("Activation Statistics:\n");
     DUMP_STAT64(numActiveUpdates);
     DUMP_STAT64(numUpdatesProcessed);
+    DUMP_STAT64(numIdleEdges);
+    DUMP_STAT64(numSkippedEdges);
 #ifdef ENABLE_ACTIVATION_STATS
     DUMP_STAT64(numActivations);
     DUMP_STAT64(numDeactivations);
@@ -228,6 +240,59 @@ void Sim::cleanupInternal ()
     stats.reset();
 }
 
+////////////////////////////////////////////////////////////////////////
+//
+// findReplayCheckpoint()
+//
+// Return the latest checkpoint file <CheckpointName>_<time>.ckp with a 
+// time (in ns) at or before WavesStartTime, or "" if there isn't one.
+//
+////////////////////////////////////////////////////////////////////////
+static string findReplayCheckpoint ()
+{
+    string name = *params.CheckpointName;
+    size_t slash = name.find_last_of("/\\");
+    string dir = (slash == string::npos) ? "." : name.substr(0, slash + 1);
+    string prefix = name.substr((slash == string::npos) ? 0 : slash + 1) + "_";
+
+    std::vector<string> files;
+#ifdef _MSC_VER
+    _finddata_t entry;
+    intptr_t handle = _findfirst(*(dir + "/*.ckp"), &entry);
+    if (handle != -1)
+    {
+        do
+            files.push_back(entry.name);
+        while (!_findnext(handle, &entry));
+        _findclose(handle);
+    }
+#else
+    DIR *d = opendir(*dir);
+    if (d)
+    {
+        while (struct dirent *entry = readdir(d))
+            files.push_back(entry->d_name);
+        closedir(d);
+    }
+#endif
+
+    string best;
+    uint64 bestTime = 0;
+    for (unsigned i = 0 ; i < files.size() ; i++)
+    {
+        const char *file = *files[i];
+        if (strncmp(file, *prefix, prefix.size()) || !isdigit(file[prefix.size()]))
+            continue;
+        char *end;
+        uint64 t = strtoull(file + prefix.size(), &end, 10);
+        if (strcmp(end, ".ckp") || (t > params.WavesStartTime) || ((best != "") && (t <= bestTime)))
+            continue;
+        best = (slash == string::npos) ? files[i] : dir + files[i];
+        bestTime = t;
+    }
+    return best;
+}
+
 ////////////////////////////////////////////////////////////////////////
 //
 // init()
@@ -274,6 +339,7 @@ void Sim::init ()
 
     // Initialize ports and create the update array
     ClockDomain::initialize();
+    stats.numHugePageBytes = getHugePageBytes();
 
     // Resolve combinational port connections
     PortWrapper::finalizeConnectedPorts();
@@ -303,10 +369,18 @@ void Sim::init ()
     reset();
 
     // Possibly restore from checkpoint
-    if (*params.RestoreFromCheckpoint != "")
+    string checkpoint = *params.RestoreFromCheckpoint;
+    if (params.ReplayWaves)
     {
-        logInfo("Restoring simulation from %s...\n", params.RestoreFromCheckpoint->c_str());
-        SimArchive::loadSimulation(params.RestoreFromCheckpoint->c_str());
+        CascadeValidate(checkpoint == "", "RestoreFromCheckpoint cannot be used with ReplayWaves");
+        checkpoint = findReplayCheckpoint();
+        if (checkpoint == "")
+            logInfo("No checkpoint found at or before %" PRIu64 " ns; replaying waves from time 0\n", (uint64) params.WavesStartTime);
+    }
+    if (checkpoint != "")
+    {
+        logInfo("Restoring simulation from %s...\n", *checkpoint);
+        SimArchive::loadSimulation(*checkpoint);
 
         // Set the global tracing flag using the restored time
         tracing = (simTime >= 1000 * params.TraceStartTime && simTime <= 1000 * params.TraceStopTime);
@@ -320,8 +394,9 @@ void Sim::init ()
     }
     logInfo("Simulation initialized (%d seconds).\n", int(time(NULL) - start));
 
-    // Set next checkpoint time
-    if (params.CheckpointInterval)
+    // Set next checkpoint time.  A waves replay doesn't write checkpoints so
+    // that several replays can run from the same set of checkpoint files.
+    if (params.CheckpointInterval && !params.ReplayWaves)
         nextCheckpoint = simTime + params.CheckpointInterval * 1000;
     else
         nextCheckpoint = (uint64) 0x7fffffffffffffffLL;
@@ -406,6 +481,11 @@ static void checkOutputs (Component *component, bool snapshot)
     for ( ; it ; it++)
     {
         int size = it.entry()->portInfo->sizeInBytes;
+
+        // For an output fifo the value pointer refers to the GenericFifo, so
+        // only compare the fifo state (not whatever follows the header)
+        if ((it.entry()->direction == PORT_OUTFIFO) && (size > (int) descore_offsetof(GenericFifo, size)))
+            size = descore_offsetof(GenericFifo, size);
         if (size + numBytes > (int) g_portSnapshot.size())
             g_portSnapshot.resize(size + numBytes);
         byte *value = *(byte **) it.address();
@@ -692,6 +772,98 @@ void Sim::dumpSignals (const Component *c, const char *wcSignals, int level /* =
     Cascade::Waves::dumpSignals(c, wcSignals, level);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Fifo statistics
+//
+////////////////////////////////////////////////////////////////////////////////
+void Sim::getFifoStats (std::vector<FifoStats> &stats)
+{
+    assert_always(state == SimInitialized, "Fifo statistics are only available after Sim::init()");
+    assert_always(params.FifoStats, "Fifo statistics are disabled (set cascade.FifoStats)");
+    stats.clear();
+    ClockDomain::getFifoStats(stats);
+}
+
+// Sort by full cycles, then by starved cycles
+static bool compareFifoStalls (const FifoStats &lhs, const FifoStats &rhs)
+{
+    if (lhs.fullCycles != rhs.fullCycles)
+        return lhs.fullCycles > rhs.fullCycles;
+    if (lhs.starvedCycles != rhs.starvedCycles)
+        return lhs.starvedCycles > rhs.starvedCycles;
+    return lhs.name < rhs.name;
+}
+
+void Sim::dumpFifoStats (int maxFifos /* = 0 */)
+{
+    std::vector<FifoStats> stats;
+    getFifoStats(stats);
+    std::sort(stats.begin(), stats.end(), compareFifoStalls);
+    if (maxFifos && (int) stats.size() > maxFifos)
+        stats.resize(maxFifos);
+
+    descore::Table t(" Fifo|NOLPAD", "Size", "Cycles", "Full", "Starved", "Push rate", 
+                     "Mean occ", "Max occ", "Occupancy histogram (%)|LALIGN");
+    for (const FifoStats &s : stats)
+    {
+        double cycles = s.cycles ? (double) s.cycles : 1.0;
+        string histogram;
+        for (int i = 0 ; i < FIFO_STATS_BUCKETS ; i++)
+            histogram += str("%s%3d", i ? " " : "", (int) (100.0 * s.histogram[i] / cycles + 0.5));
+        t.addRow(s.name, str("%d", s.capacity), str("%" PRId64, s.cycles), str("%" PRId64, s.fullCycles), 
+                 str("%" PRId64, s.starvedCycles), str("%.3lf", s.pushes / cycles), 
+                 str("%.2lf", s.occupancySum / cycles), str("%d", s.maxOccupancy), histogram);
+    }
+    log("\n=== Fifo Statistics ===\n\n");
+    t.print();
+}
+
+void Sim::resetFifoStats ()
+{
+    ClockDomain::doAcross(&PortStorage::resetFifoStats);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// writeFifoSizingReport()
+//
+// The producer sees a fifo entry as occupied from the time it is pushed until 
+// the credit for its pop returns, so the peak producer-side occupancy (which is
+// tracked exactly, including within a cycle) is the smallest size with which 
+// no push would have been blocked.  If the fifo was ever full then a smaller 
+// size would have introduced stalls, and a larger size might have removed some, 
+// so the size is left unchanged.
+//
+////////////////////////////////////////////////////////////////////////////////
+void Sim::writeFifoSizingReport (const char *filename)
+{
+    std::vector<FifoStats> stats;
+    getFifoStats(stats);
+
+    FILE *f = fopen(filename, "w");
+    assert_always(f, "Could not open %s for writing", filename);
+    fprintf(f, "# Fifo sizing report at time %" PRIu64 " ps\n", simTime);
+    fprintf(f, "# <fifo> <size> <suggested size>\n");
+    int64 totalSize = 0;
+    int64 totalSuggested = 0;
+    for (const FifoStats &s : stats)
+    {
+        int suggested = s.capacity;
+        if (s.highWaterMark < s.capacity)
+            suggested = std::max(std::max(s.highWaterMark, s.minSize), 1);
+        fprintf(f, "%s %d %d", *s.name, s.capacity, suggested);
+        if (s.highWaterMark == s.capacity)
+            fprintf(f, " # full on %" PRId64 " of %" PRId64 " cycles", s.fullCycles, s.cycles);
+        fprintf(f, "\n");
+        totalSize += s.capacity;
+        totalSuggested += suggested;
+    }
+    fclose(f);
+    log("Wrote fifo sizing report for %d fifos to %s (%" PRId64 " -> %" PRId64 " entries)\n",
+        (int) stats.size(), filename, totalSize, totalSuggested);
+}
+
 /////////////////////////////////////////////////////////////////
 //
 // getComponent()
@@ -760,6 +932,10 @@ void Sim::errorHook (descore::runtime_error &error)
 
 static void simFatalHook (const descore::runtime_error &error)
 {
+    // Write the waves history leading up to the failure
+    if (params.WavesHistory)
+        Waves::dumpHistory(true);
+
     if (Sim::isVerilogSimulation)
         tf_dofinish();
 
@@ -0,0 +1,216 @@
+/*
+Copyright 2007, D. E. Shaw Research.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+* Redistributions of source code must retain the above copyright
+  notice, this list of conditions, and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions, and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+* Neither the name of D. E. Shaw Research nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+//////////////////////////////////////////////////////////////////////
+//
+// SimMemory.cpp
+//
+// Copyright (C) 2026 D. E. Shaw Research
+//
+// Created: 10/18/2026
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "stdafx.h"
+#include "SimDefs.hpp"
+#include "SimGlobals.hpp"
+#include "Params.hpp"
+#include "SimMemory.hpp"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#define HUGE_PAGE_SIZE 0x200000
+#endif
+
+BEGIN_NAMESPACE_CASCADE
+
+#ifdef __linux__
+
+// Arenas that were allocated with mmap(), indexed by address.  The mapped
+// size is rounded up to a multiple of the huge page size.  The hugetlb
+// flag indicates that the arena is backed by explicitly reserved huge pages;
+// otherwise the arena has been advised to use transparent huge pages.
+struct MappedArena
+{
+    int64 size;
+    int64 mappedSize;
+    bool  hugetlb;
+};
+typedef std::map<byte *, MappedArena, descore::allow_ptr<byte *> > MappedArenaMap;
+static MappedArenaMap s_mappedArenas;
+
+////////////////////////////////////////////////////////////////////////
+//
+// mapArena()
+//
+////////////////////////////////////////////////////////////////////////
+static byte *mapArena (int64 size, bool &hugetlb)
+{
+    // First try to use explicitly reserved huge pages
+#ifdef MAP_HUGETLB
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED)
+    {
+        hugetlb = true;
+        return (byte *) data;
+    }
+#endif
+
+    // Fall back to transparent huge pages.  Over-allocate so that the arena
+    // can be aligned to a huge page boundary, then unmap the excess.
+    hugetlb = false;
+    int64 mapSize = size + HUGE_PAGE_SIZE;
+    byte *base = (byte *) mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == (byte *) MAP_FAILED)
+        return NULL;
+    byte *aligned = (byte *) (((intptr_t) base + HUGE_PAGE_SIZE - 1) & ~((intptr_t) HUGE_PAGE_SIZE - 1));
+    if (aligned > base)
+        munmap(base, aligned - base);
+    if (base + mapSize > aligned + size)
+        munmap(aligned + size, base + mapSize - (aligned + size));
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+    return aligned;
+}
+
+#endif // #ifdef __linux__
+
+////////////////////////////////////////////////////////////////////////
+//
+// allocSimMemory()
+//
+////////////////////////////////////////////////////////////////////////
+byte *allocSimMemory (int64 size)
+{
+#ifdef __linux__
+    // Don't bother with huge pages for arenas that are much smaller than a huge page
+    if (params.HugePages && size >= HUGE_PAGE_SIZE / 2)
+    {
+        MappedArena arena;
+        arena.size = size;
+        arena.mappedSize = (size + HUGE_PAGE_SIZE - 1) & ~((int64) HUGE_PAGE_SIZE - 1);
+        byte *data = mapArena(arena.mappedSize, arena.hugetlb);
+        if (data)
+        {
+            s_mappedArenas[data] = arena;
+            return data;
+        }
+        log("Warning: Unable to allocate %" PRId64 " bytes of huge page storage; using regular pages instead\n", arena.mappedSize);
+    }
+#endif
+    return new byte[size];
+}
+
+////////////////////////////////////////////////////////////////////////
+//
+// freeSimMemory()
+//
+////////////////////////////////////////////////////////////////////////
+void freeSimMemory (byte *data, int64 size)
+{
+#ifdef __linux__
+    MappedArenaMap::iterator it = s_mappedArenas.find(data);
+    if (it != s_mappedArenas.end())
+    {
+        CascadeValidate(size == it->second.size, "freeSimMemory() size (%" PRId64 ") does not match the allocated size (%" PRId64 ")", 
+            size, it->second.size);
+        munmap(data, it->second.mappedSize);
+        s_mappedArenas.erase(it);
+        return;
+    }
+#else
+    (void) size;
+#endif
+    delete[] data;
+}
+
+////////////////////////////////////////////////////////////////////////
+//
+// getHugePageBytes()
+//
+// Arenas backed by reserved huge pages are counted in full.  For
+// transparent huge pages the kernel decides which pages are actually
+// promoted, so we consult /proc/self/smaps.  Padding at the end of an
+// arena is not counted.
+//
+////////////////////////////////////////////////////////////////////////
+int64 getHugePageBytes ()
+{
+    int64 ret = 0;
+#ifdef __linux__
+    bool checkSmaps = false;
+    for (MappedArenaMap::iterator it = s_mappedArenas.begin() ; it != s_mappedArenas.end() ; it++)
+    {
+        if (it->second.hugetlb)
+            ret += it->second.size;
+        else
+            checkSmaps = true;
+    }
+    if (!checkSmaps)
+        return ret;
+
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if (!f)
+        return ret;
+    char line[512];
+    int64 overlap = 0;
+    while (fgets(line, sizeof(line), f))
+    {
+        // Mapping header: determine how much of the mapping overlaps transparent huge page arenas
+        unsigned long start, end;
+        if (sscanf(line, "%lx-%lx", &start, &end) == 2)
+        {
+            overlap = 0;
+            for (MappedArenaMap::iterator it = s_mappedArenas.begin() ; it != s_mappedArenas.end() ; it++)
+            {
+                if (it->second.hugetlb)
+                    continue;
+                unsigned long arenaStart = (unsigned long) it->first;
+                unsigned long arenaEnd = arenaStart + it->second.size;
+                if (arenaStart < end && arenaEnd > start)
+                    overlap += min(end, arenaEnd) - max(start, arenaStart);
+            }
+            continue;
+        }
+
+        // Huge pages in the current mapping
+        long kb;
+        if (overlap && sscanf(line, "AnonHugePages: %ld kB", &kb) == 1)
+            ret += min((int64) kb * 1024, overlap);
+    }
+    fclose(f);
+#endif
+    return ret;
+}
+
+END_NAMESPACE_CASCADE
@@ -46,6 +46,13 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <descore/Wildcard.hpp>
 #include <descore/Iterators.hpp>
 #include <descore/MapIterators.hpp>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <zlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
 
 BEGIN_NAMESPACE_CASCADE
 
@@ -65,8 +72,21 @@ struct WavesDumpSpecifier
     int level;
 };
 
+// Runtime dumping request (Waves::setDumping)
+struct WavesDumpRequest
+{
+    bool   global;     // Enable/disable all dumping rather than a set of signals
+    string component;
+    string signals;
+    bool   enable;
+};
+
 static WavesComponent g_top;
 static std::vector<WavesDumpSpecifier> g_dumpSpecifiers;
+static std::vector<WavesDumpRequest> g_dumpRequests;
+static descore::SpinLock g_dumpRequestLock;
+static volatile bool g_dumpRequestsPending = false;
+static bool g_setDumpingEnabled = true; // Most recent Waves::setDumping(bool)
 static WavesFile *g_file = NULL;
 static bool g_dumping = false;
 static WavesComponent *g_currComponent = NULL;
@@ -102,6 +122,72 @@ void Waves::dumpSignals (const Component *component, const char *wcSignals, int
     g_dumpSpecifiers.push_back(w);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Waves::setDumping()
+//
+////////////////////////////////////////////////////////////////////////////////
+bool Waves::enabled = true;
+
+void Waves::setDumping (bool enable)
+{
+    WavesDumpRequest r = { true, "", "", enable };
+    descore::ScopedSpinLock lock(g_dumpRequestLock);
+    g_dumpRequests.push_back(r);
+    g_dumpRequestsPending = true;
+}
+
+void Waves::setDumping (const char *wcComponent, const char *wcSignals, bool enable)
+{
+    WavesDumpRequest r = { false, wcComponent, wcSignals, enable };
+    descore::ScopedSpinLock lock(g_dumpRequestLock);
+    g_dumpRequests.push_back(r);
+    g_dumpRequestsPending = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Waves::updateDumping()
+//
+////////////////////////////////////////////////////////////////////////////////
+void Waves::updateDumping ()
+{
+    if (!g_dumping)
+        return;
+
+    // Apply the pending requests
+    if (g_dumpRequestsPending)
+    {
+        std::vector<WavesDumpRequest> requests;
+        {
+            descore::ScopedSpinLock lock(g_dumpRequestLock);
+            requests.swap(g_dumpRequests);
+            g_dumpRequestsPending = false;
+        }
+        for (int i = 0 ; i < (int) requests.size() ; i++)
+        {
+            const WavesDumpRequest &r = requests[i];
+            if (r.global)
+                g_setDumpingEnabled = r.enable;
+            else
+                g_top.setDumping("", *r.component, *r.signals, r.enable);
+        }
+        WavesSnapshot::invalidate();
+    }
+
+    // Enable or disable dumping
+    bool enable = g_setDumpingEnabled && 
+                  (Sim::simTime >= 1000 * params.WavesStartTime) && 
+                  (Sim::simTime / 1000 <= params.WavesStopTime);
+    if (enable != enabled)
+    {
+        if (!enable)
+            g_top.dumpOff();
+        enabled = enable;
+        WavesSnapshot::invalidate();
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Waves::archive()
@@ -113,6 +199,11 @@ void Waves::archive ()
         return;
 
     g_top.doAcross(&IWavesFunctions::archive);
+    WavesSnapshot::invalidate();
+
+    // Apply WavesStartTime/WavesStopTime at the restored time so that the
+    // restarted file doesn't begin with values from outside the window
+    updateDumping();
 
     delete g_file;
     initWavesFile();
@@ -173,6 +264,43 @@ void Waves::cleanup ()
     g_dumping = false;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Waves::nextStep()
+//
+////////////////////////////////////////////////////////////////////////////////
+void Waves::nextStep ()
+{
+    if (g_file)
+        g_file->nextStep();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Waves::flush()
+//
+////////////////////////////////////////////////////////////////////////////////
+void Waves::flush ()
+{
+    if (g_file)
+        g_file->flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Waves::dumpHistory()
+//
+////////////////////////////////////////////////////////////////////////////////
+void Waves::dumpHistory (bool closeFile)
+{
+    if (g_file)
+    {
+        g_file->dumpHistory();
+        if (closeFile)
+            g_file->close();
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // initWaves()
@@ -294,11 +422,20 @@ WavesComponent *Waves::getWavesComponent (const Component *c)
 ////////////////////////////////////////////////////////////////////////////////
 void initWavesFile ()
 {
-    g_file = new VcdWavesFile;
-    g_file->open(params.WavesFilename->c_str());
+    string filename = *params.WavesFilename;
+    if (params.WavesFormat == CascadeParams::Cwf)
+        g_file = new CwfWavesFile;
+    else
+    {
+        g_file = new VcdWavesFile;
+        if (params.WavesCompress && ((filename.size() < 3) || (filename.substr(filename.size() - 3) != ".gz")))
+            filename += ".gz";
+    }
+    g_file->open(filename.c_str());
     g_top.writeIndex();
     g_file->endSignals();
     g_top.doAcross(&IWavesFunctions::dumpInitialValues);
+    g_file->flush();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -314,6 +451,7 @@ m_currVal(new byte[(info->sizeInBits + 7)/8]),
 m_validValue(0),
 m_currValid(0xff),
 m_type(type),
+m_enabled(true),
 m_id(0),
 m_index(index)
 {
@@ -383,6 +521,8 @@ void WavesSignal::dump ()
 {
     uint32 buff[CASCADE_MAX_PORT_SIZE / 32];
     assert(g_file);
+    if (!m_enabled || !Waves::enabled)
+        return;
 
     // Get the current validValue
     byte currValid = 0;
@@ -404,6 +544,106 @@ void WavesSignal::dump ()
     }
 }
 
+void WavesSignal::dumpOff ()
+{
+    if (m_enabled && (m_currValid != 0xff))
+        g_file->valueChange(m_id, m_currVal, true, m_info->sizeInBits);
+    m_currValid = 0xff;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// WavesSnapshot
+//
+////////////////////////////////////////////////////////////////////////////////
+uint32 WavesSnapshot::s_epoch = 1;
+
+WavesSnapshot::WavesSnapshot (WavesSignal *signals) : m_signals(signals), m_epoch(0)
+{
+}
+
+void WavesSnapshot::build ()
+{
+    uint32 offset = 0;
+    m_entries.clear();
+    for (WavesSignal *s = m_signals ; s ; s = s->next)
+    {
+        if (!s->m_enabled)
+            continue;
+        Entry e;
+        e.data = s->m_data;
+        e.signal = s;
+        e.offset = offset;
+        e.size = s->m_info->sizeInBytes;
+        if (s->m_validValue)
+        {
+            e.data--;
+            e.size++;
+        }
+        m_entries.push_back(e);
+        offset += (e.size + 7) & ~7;
+    }
+    m_shadow.resize(offset + 8);
+}
+
+void WavesSnapshot::invalidate ()
+{
+    s_epoch++;
+}
+
+// Compare eight bytes at a time; the shadow is padded to a multiple of 8
+// bytes but the port data is not, so the tail is compared bytewise.
+static inline bool snapshotDiffers (const byte *shadow, const byte *data, uint32 size)
+{
+    uint64 diff = 0;
+    uint32 i = 0;
+    for ( ; i + 8 <= size ; i += 8)
+    {
+        uint64 a, b;
+        memcpy(&a, shadow + i, 8);
+        memcpy(&b, data + i, 8);
+        diff |= a ^ b;
+    }
+    for ( ; i < size ; i++)
+        diff |= shadow[i] ^ data[i];
+    return diff != 0;
+}
+
+void WavesSnapshot::dump ()
+{
+    // Dump everything after the file has been restarted or the set of
+    // enabled signals has changed
+    bool dumpAll = (m_epoch != s_epoch);
+    if (dumpAll)
+    {
+        m_epoch = s_epoch;
+        build();
+    }
+
+    byte *shadow = &m_shadow[0];
+    int numEntries = (int) m_entries.size();
+    if (dumpAll)
+    {
+        for (int i = 0 ; i < numEntries ; i++)
+        {
+            const Entry &e = m_entries[i];
+            memcpy(shadow + e.offset, e.data, e.size);
+            e.signal->dump();
+        }
+        return;
+    }
+
+    for (int i = 0 ; i < numEntries ; i++)
+    {
+        const Entry &e = m_entries[i];
+        if (snapshotDiffers(shadow + e.offset, e.data, e.size))
+        {
+            memcpy(shadow + e.offset, e.data, e.size);
+            e.signal->dump();
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // WavesFifo
@@ -413,6 +653,7 @@ WavesFifo::WavesFifo (WavesSignal::SignalType type, FifoPort<byte> *port, const
 : dataSignal(type, NULL, info, index),
 validSignal(type, &m_valid, getPortInfo<bit>(), index + 1),
 creditSignal(type, &m_credit, getPortInfo<bit>(), index + 2),
+countSignal(type, &m_count, getPortInfo<uint32>(), index + 3),
 next(NULL),
 m_valid(0),
 m_credit(0),
@@ -420,6 +661,10 @@ m_head(0),
 m_tail(0),
 m_freeCount(0),
 m_fullCount(0),
+m_count(0),
+m_contentsHead(0),
+m_numPushes(0),
+m_contentsEpoch(0),
 m_fifoPort(port),
 m_name(name)
 {
@@ -457,10 +702,10 @@ void WavesFifo::resolve ()
     {
         WavesFifoTriggerProxy *proxy = new WavesFifoTriggerProxy(m_fifo);
         dataSignal.m_data = proxy->m_data;
-        if (dataSignal.m_type == WavesSignal::FIFO_PRODUCER && m_fifo->producerClockDomain)
-            m_fifo->producerClockDomain->addWavesFifo(this);
+        if (dataSignal.m_type == WavesSignal::FIFO_PRODUCER && m_fifo->links->producerClockDomain)
+            m_fifo->links->producerClockDomain->addWavesFifo(this);
         else
-            m_fifo->consumerClockDomain->addWavesFifo(this);
+            m_fifo->links->consumerClockDomain->addWavesFifo(this);
 
         // Overwrite m_type and m_fifo
         dataSignal.m_type = WavesSignal::FIFO_TRIGGER;
@@ -478,14 +723,38 @@ void WavesFifo::resolve ()
     m_freeCount = m_fifo->freeCount;
     m_fullCount = m_fifo->fullCount;
 
-    if (dataSignal.m_type == WavesSignal::FIFO_PRODUCER && m_fifo->producerClockDomain)
-        m_fifo->producerClockDomain->addWavesFifo(this);
-    if (dataSignal.m_type == WavesSignal::FIFO_CONSUMER && m_fifo->consumerClockDomain)
-        m_fifo->consumerClockDomain->addWavesFifo(this);
+    if (params.WavesFifoContents && (m_fifo->size / m_fifo->dataSize <= params.WavesFifoContents))
+        addContents();
+
+    if (dataSignal.m_type == WavesSignal::FIFO_PRODUCER && m_fifo->links->producerClockDomain)
+        m_fifo->links->producerClockDomain->addWavesFifo(this);
+    if (dataSignal.m_type == WavesSignal::FIFO_CONSUMER && m_fifo->links->consumerClockDomain)
+        m_fifo->links->consumerClockDomain->addWavesFifo(this);
+}
+
+// The occupancy is added as <name>_count, and the ring slots as a child
+// component <name>_entries.  Slots are dumped as x while they are free.
+void WavesFifo::addContents ()
+{
+    g_currComponent->signals[m_name + "_count"] = &countSignal;
+
+    WavesComponent *wc = new WavesComponent(g_currComponent->domain);
+    g_currComponent->children[m_name + "_entries"] = wc;
+    int numSlots = m_fifo->size / m_fifo->dataSize;
+    for (int i = 0 ; i < numSlots ; i++)
+    {
+        WavesSignal *s = new WavesSignal(WavesSignal::FIFO_PRODUCER, m_fifo->data + i * m_fifo->dataSize, dataSignal.m_info, i);
+        wc->signals[*strbuff("slot[%d]", i)] = s;
+        m_slots.push_back(s);
+    }
+    resetContents();
 }
 
 void WavesFifo::archive ()
 {
+    if (m_slots.size())
+        resetContents();
+
     int numPendingPushes = m_fullCount;
     m_head = m_fifo->head;
     m_tail = m_fifo->tail;
@@ -514,14 +783,17 @@ void WavesFifo::tick ()
     {
         if (dataSignal.m_type == WavesSignal::FIFO_CONSUMER)
         {
-            // Consumer (valid, data); delay > 0
-            m_valid = (m_fullCount != m_fifo->fullCount);
+            // Consumer (valid, data); delay > 0.  Several entries can land in
+            // the same cycle; dump the first one and skip over the rest.
+            int numPushed = (int) (m_fifo->fullCount - m_fullCount);
+            m_valid = (numPushed != 0);
             if (m_valid)
             {
                 dataSignal.m_data = m_fifo->data + m_tail;
-                if (!m_tail)
-                    m_tail = m_fifo->size;
-                m_tail -= m_fifo->dataSize;
+                int tail = (int) m_tail - numPushed * m_fifo->dataSize;
+                while (tail < 0)
+                    tail += m_fifo->size;
+                m_tail = tail;
             }
         }
         else
@@ -569,6 +841,82 @@ void WavesFifo::update ()
         dataSignal.dump();
     if (!m_fifo->noflow)
         creditSignal.dump();
+    if (m_slots.size())
+        dumpContents();
+}
+
+void WavesFifo::resetContents ()
+{
+    m_count = (m_fifo->size / m_fifo->dataSize) - m_fifo->freeCount;
+    m_contentsHead = (m_fifo->tail + m_count * m_fifo->dataSize) % m_fifo->size;
+    m_numPushes = m_fifo->numPushes;
+    m_contentsEpoch = 0;
+}
+
+// Dump the slot at byte offset 'offset' as its data if it is occupied,
+// or as x if it is free
+void WavesFifo::dumpSlot (uint32 offset)
+{
+    uint32 distance = (m_contentsHead >= offset) ? m_contentsHead - offset : m_contentsHead + m_fifo->size - offset;
+    WavesSignal *s = m_slots[offset / m_fifo->dataSize];
+    if (distance / m_fifo->dataSize < m_count)
+        s->dump();
+    else
+        s->dumpOff();
+}
+
+void WavesFifo::dumpContents ()
+{
+    // Entries are pushed at the tail and freed at the head, both of which
+    // move towards lower addresses.  Entries that are popped but still 
+    // waiting to return their credit remain occupied.
+    uint32 size = m_fifo->size;
+    uint32 dataSize = m_fifo->dataSize;
+    uint32 numSlots = size / dataSize;
+    uint32 count = numSlots - m_fifo->freeCount;
+    uint32 prevHead = m_contentsHead;
+    int64 numPushed = (uint32) (m_fifo->numPushes - m_numPushes);
+    int64 numFreed = (int64) m_count + numPushed - count;
+    m_count = count;
+    m_contentsHead = (m_fifo->tail + count * dataSize) % size;
+    m_numPushes = m_fifo->numPushes;
+    if (!Waves::enabled)
+        return;
+
+    // Visit every slot after the waves file has been restarted or dumping
+    // has been re-enabled
+    if (m_contentsEpoch != WavesSnapshot::s_epoch)
+    {
+        m_contentsEpoch = WavesSnapshot::s_epoch;
+        for (uint32 offset = 0 ; offset < size ; offset += dataSize)
+            dumpSlot(offset);
+        countSignal.dump();
+        return;
+    }
+
+    // Slots freed since the previous update, starting at the previous head
+    if (numFreed > numSlots)
+        numFreed = numSlots;
+    uint32 offset = prevHead;
+    for (int64 i = 0 ; i < numFreed ; i++)
+    {
+        dumpSlot(offset);
+        offset = (offset ? offset : size) - dataSize;
+    }
+
+    // Slots pushed since the previous update, ending at the tail
+    if (numPushed > numSlots)
+        numPushed = numSlots;
+    offset = m_fifo->tail;
+    for (int64 i = 0 ; i < numPushed ; i++)
+    {
+        offset += dataSize;
+        if (offset == size)
+            offset = 0;
+        dumpSlot(offset);
+    }
+
+    countSignal.dump();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -616,6 +964,35 @@ void WavesComponent::doAcross (wavefunc f)
     g_currComponent = NULL;
 }
 
+void WavesComponent::setDumping (const string &path, const char *wcComponent, const char *wcSignals, bool enable)
+{
+    if ((path != "") && wildcardMatch(*path, wcComponent))
+    {
+        for (Iterator<SignalMap> it(signals) ; it ; it++)
+        {
+            WavesSignal *s = *it;
+            if ((s->m_enabled != enable) && wildcardMatch(*it.key(), wcSignals))
+            {
+                if (!enable && Waves::enabled)
+                    s->dumpOff();
+                s->m_enabled = enable;
+                s->m_currValid = 0xff;
+            }
+        }
+    }
+
+    for (MapItem<ComponentMap> itc : children)
+        itc.value->setDumping((path == "") ? itc.key : path + "." + itc.key, wcComponent, wcSignals, enable);
+}
+
+void WavesComponent::dumpOff ()
+{
+    for_map_values (WavesSignal *s, signals)
+        s->dumpOff();
+    for_map_values (WavesComponent *c, children)
+        c->dumpOff();
+}
+
 WavesComponent::~WavesComponent ()
 {
     cleanup();
@@ -630,6 +1007,7 @@ void WavesComponent::cleanup ()
         signals.erase(fifos[i]->m_name);
         signals.erase(fifos[i]->m_name + "_valid");
         signals.erase(reversePortDirection(fifos[i]->m_name) + "_credit");
+        signals.erase(fifos[i]->m_name + "_count");
         delete fifos[i];
     }
     for_map_values (WavesSignal *s, signals)
@@ -663,14 +1041,44 @@ void WavesComponent::writeIndex ()
 // WaveFile
 //
 ////////////////////////////////////////////////////////////////////////////////
-WavesFile::WavesFile () : m_file(NULL), m_currSimTime(uint64(-1))
+uint32 WavesFile::s_nextGeneration = 1;
+static __thread void *t_wavesBuffer = NULL;
+static __thread uint32 t_wavesGeneration = 0;
+
+// Write any waves that are still buffered when the process exits without
+// cleaning up the simulation
+static void drainWavesAtExit ()
+{
+    if (g_file)
+        g_file->drain();
+}
+
+WavesFile::WavesFile () : 
+m_file(NULL), 
+m_currTime(0), 
+m_currSimTime(uint64(-1)),
+m_step(0),
+m_generation(s_nextGeneration++),
+m_pendingBytes(0),
+m_exitWriter(false),
+m_writer(NULL)
 {
 }
 
 WavesFile::~WavesFile ()
 {
+    drain();
     if (m_file)
         fclose(m_file);
+    for (int i = 0 ; i < (int) m_threadBuffers.size() ; i++)
+    {
+        delete[] m_threadBuffers[i]->data;
+        delete m_threadBuffers[i];
+    }
+    for (int i = 0 ; i < (int) m_freeData.size() ; i++)
+        delete[] m_freeData[i];
+    for (int i = 0 ; i < (int) m_history.size() ; i++)
+        delete[] m_history[i].buffer.data;
 }
 
 void WavesFile::open (const char *filename)
@@ -682,39 +1090,356 @@ void WavesFile::open (const char *filename)
 
 void WavesFile::close ()
 {
+    drain();
     if (m_file)
     {
         if (Sim::simTime > m_currTime)
             dumpTime(Sim::simTime);
+        endFile();
         fclose(m_file);
     }
     m_file = NULL;
 }
 
+int WavesFile::recordSize (const Record *record)
+{
+    return (int) sizeof(Record) + (record->undefined ? 0 : ((record->sizeInBits + 63) / 64) * 8);
+}
+
+WavesFile::Buffer *WavesFile::getThreadBuffer ()
+{
+    if (t_wavesGeneration != m_generation)
+    {
+        Buffer *buffer = new Buffer;
+        buffer->data = NULL;
+        buffer->size = 0;
+        buffer->capacity = 0;
+        descore::ScopedSpinLock lock(m_bufferLock);
+        m_threadBuffers.push_back(buffer);
+        t_wavesBuffer = buffer;
+        t_wavesGeneration = m_generation;
+    }
+    return (Buffer *) t_wavesBuffer;
+}
+
+void WavesFile::nextStep ()
+{
+    descore::atomicIncrement(m_step);
+}
+
 void WavesFile::valueChange (uint32 id, const byte *value, bool undefined, int sizeInBits)
 {
-    // Whenever the simulation time changes, write out a new timestamp.  But the 
-    // simulation time might not be monotonically increasing (due to manual clock 
-    // domains), whereas the VCD file time must be.  Also, place a restriction 
-    // (10 ps by default) on the minimum time granularity.  The net result is that 
-    // if the requested increase in time is negative or less than 10 ps, then just 
-    // increase the previous timestamp by 10 instead of taking on the new simulation time.
-    if (m_currSimTime != Sim::simTime)
+    Buffer *buffer = getThreadBuffer();
+    int valueBytes = undefined ? 0 : ((sizeInBits + 63) / 64) * 8;
+    int recordBytes = (int) sizeof(Record) + valueBytes;
+    if (buffer->size + recordBytes > buffer->capacity)
     {
-        if (m_currSimTime == uint64(-1))
-            m_currTime = Sim::simTime;
-        else
+        int capacity = buffer->capacity ? buffer->capacity : 0x10000;
+        while (buffer->size + recordBytes > capacity)
+            capacity *= 2;
+        byte *data = new byte[capacity];
+        if (buffer->size)
+            memcpy(data, buffer->data, buffer->size);
+        delete[] buffer->data;
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+
+    Record *record = (Record *) (buffer->data + buffer->size);
+    record->simTime = Sim::simTime;
+    record->step = (uint32) m_step;
+    record->id = id;
+    record->sizeInBits = sizeInBits;
+    record->undefined = undefined;
+    if (valueBytes)
+        memcpy(record + 1, value, (sizeInBits + 7) / 8);
+    buffer->size += recordBytes;
+}
+
+void WavesFile::flush ()
+{
+    // In flight recorder mode, copy the buffered changes into the history
+    if (params.WavesHistory)
+    {
+        descore::ScopedSpinLock lock(m_bufferLock);
+        for (int i = 0 ; i < (int) m_threadBuffers.size() ; i++)
+        {
+            if (m_threadBuffers[i]->size)
+            {
+                recordHistory(*m_threadBuffers[i]);
+                m_threadBuffers[i]->size = 0;
+            }
+        }
+        return;
+    }
+
+    // Collect the buffered changes from every thread
+    Batch *batch = new Batch;
+    batch->bytes = 0;
+    {
+        descore::ScopedSpinLock lock(m_bufferLock);
+        for (int i = 0 ; i < (int) m_threadBuffers.size() ; i++)
+        {
+            Buffer *buffer = m_threadBuffers[i];
+            if (buffer->size)
+            {
+                batch->buffers.push_back(*buffer);
+                batch->bytes += buffer->capacity;
+                buffer->size = 0;
+                buffer->capacity = 0;
+                buffer->data = NULL;
+            }
+        }
+    }
+    if (!batch->bytes)
+    {
+        delete batch;
+        return;
+    }
+
+    if (!params.WavesWriterThread)
+    {
+        writeBatch(batch);
+        return;
+    }
+
+    // Start the writer thread the first time it is needed
+    if (!m_writer)
+    {
+        static bool registeredExit = false;
+        if (!registeredExit)
+        {
+            atexit(&drainWavesAtExit);
+            registeredExit = true;
+        }
+        m_writer = new descore::Thread;
+        m_writer->start(this, &WavesFile::writerThread);
+    }
+
+    // Apply back-pressure if the writer thread has fallen behind
+    int64 maxBytes = int64(params.WavesBufferSize) << 20;
+    while (m_pendingBytes && (m_pendingBytes + batch->bytes > maxBytes))
+        descore::Thread::sleep(1);
+
+    descore::ScopedSpinLock lock(m_batchLock);
+    m_batches.push_back(batch);
+    m_pendingBytes += batch->bytes;
+
+    // Give the simulation threads recycled storage.  Only the buffers that 
+    // were handed off above are empty; the others still hold their storage.
+    for (int i = 0 ; i < (int) m_threadBuffers.size() && m_freeData.size() ; i++)
+    {
+        if (m_threadBuffers[i]->data)
+            continue;
+        m_threadBuffers[i]->data = m_freeData.back();
+        m_threadBuffers[i]->capacity = 0x10000;
+        m_freeData.pop_back();
+    }
+}
+
+void WavesFile::recordHistory (const Buffer &buffer)
+{
+    HistoryBlock block;
+    block.buffer.data = new byte[buffer.size];
+    block.buffer.size = buffer.size;
+    block.buffer.capacity = buffer.size;
+    block.simTime = Sim::simTime;
+    memcpy(block.buffer.data, buffer.data, buffer.size);
+    m_history.push_back(block);
+
+    // Fold the blocks that have fallen out of the history window into the
+    // values at the start of the window
+    uint64 window = uint64(params.WavesHistory) * 1000;
+    while (m_history.front().simTime + window < Sim::simTime)
+    {
+        applyHistory(m_history.front().buffer);
+        delete[] m_history.front().buffer.data;
+        m_history.pop_front();
+    }
+}
+
+void WavesFile::applyHistory (const Buffer &buffer)
+{
+    for (int pos = 0 ; pos < buffer.size ; )
+    {
+        const Record *record = (const Record *) (buffer.data + pos);
+        if (record->id >= m_historyValues.size())
+            m_historyValues.resize(record->id + 1);
+        HistoryValue &v = m_historyValues[record->id];
+        v.sizeInBits = record->sizeInBits;
+        v.undefined = record->undefined;
+        if (!record->undefined)
         {
-            if (m_currTime > Sim::simTime - params.WavesDT)
-                m_currTime += params.WavesDT;
+            const byte *value = (const byte *) (record + 1);
+            v.value.assign(value, value + (record->sizeInBits + 7) / 8);
+        }
+        pos += recordSize(record);
+    }
+}
+
+void WavesFile::dumpHistory ()
+{
+    flush();
+    if (m_history.empty() || !m_file)
+        return;
+
+    // Write the value of every signal at the start of the window followed by
+    // the changes within the window
+    uint32 step = ((const Record *) m_history.front().buffer.data)->step - 1;
+    Batch *batch = new Batch;
+    batch->bytes = 0;
+    Buffer initial;
+    initial.size = 0;
+    initial.capacity = 0;
+    uint32 id;
+    for (id = 0 ; id < m_historyValues.size() ; id++)
+    {
+        if (m_historyValues[id].sizeInBits)
+            initial.capacity += (int) sizeof(Record) + (int) m_historyValues[id].value.size() + 8;
+    }
+    initial.data = new byte[initial.capacity + 1];
+    for (id = 0 ; id < m_historyValues.size() ; id++)
+    {
+        const HistoryValue &v = m_historyValues[id];
+        if (!v.sizeInBits)
+            continue;
+        Record *record = (Record *) (initial.data + initial.size);
+        record->simTime = m_history.front().simTime;
+        record->step = step;
+        record->id = id;
+        record->sizeInBits = v.sizeInBits;
+        record->undefined = v.undefined;
+        if (!v.undefined)
+            memcpy(record + 1, &v.value[0], v.value.size());
+        initial.size += recordSize(record);
+    }
+    batch->buffers.push_back(initial);
+
+    while (!m_history.empty())
+    {
+        applyHistory(m_history.front().buffer);
+        batch->buffers.push_back(m_history.front().buffer);
+        m_history.pop_front();
+    }
+    writeBatch(batch);
+    flushFile();
+}
+
+void WavesFile::drain ()
+{
+    flush();
+    if (m_writer)
+    {
+        m_exitWriter = true;
+        m_writer->wait();
+        delete m_writer;
+        m_writer = NULL;
+        m_exitWriter = false;
+    }
+}
+
+void WavesFile::writerThread ()
+{
+    int numSpins = 0;
+    for (;;)
+    {
+        Batch *batch = NULL;
+        bool exit = m_exitWriter;
+        {
+            descore::ScopedSpinLock lock(m_batchLock);
+            if (m_batches.size())
+            {
+                batch = m_batches.front();
+                m_batches.erase(m_batches.begin());
+            }
+        }
+        if (!batch)
+        {
+            if (exit)
+                return;
+            if (++numSpins < 100)
+                descore::Thread::yield();
             else
-                m_currTime = Sim::simTime;
+                descore::Thread::sleep(1);
+            continue;
         }
-        m_currSimTime = Sim::simTime;
-        dumpTime(m_currTime);
+        numSpins = 0;
+
+        int bytes = batch->bytes;
+        writeBatch(batch);
+        descore::ScopedSpinLock lock(m_batchLock);
+        m_pendingBytes -= bytes;
     }
+}
 
-    dumpValue(id, value, undefined, sizeInBits);
+bool WavesFile::recordLess (const void *a, const void *b)
+{
+    // The step numbers wrap, but a batch spans far fewer than 2^31 steps
+    const Record *ra = (const Record *) a;
+    const Record *rb = (const Record *) b;
+    if (ra->step != rb->step)
+        return (int) (ra->step - rb->step) < 0;
+    return ra->id < rb->id;
+}
+
+void WavesFile::writeBatch (Batch *batch)
+{
+    // Order the changes by time step and then by signal id so that the output
+    // does not depend on how the domains were divided among the threads.
+    std::vector<const void *> records;
+    int i;
+    for (i = 0 ; i < (int) batch->buffers.size() ; i++)
+    {
+        const Buffer &buffer = batch->buffers[i];
+        for (int pos = 0 ; pos < buffer.size ; )
+        {
+            const Record *record = (const Record *) (buffer.data + pos);
+            records.push_back(record);
+            pos += recordSize(record);
+        }
+    }
+    std::stable_sort(records.begin(), records.end(), recordLess);
+
+    for (i = 0 ; i < (int) records.size() ; i++)
+    {
+        const Record *record = (const Record *) records[i];
+
+        // Whenever the simulation time changes, write out a new timestamp.  But the 
+        // simulation time might not be monotonically increasing (due to manual clock 
+        // domains), whereas the VCD file time must be.  Also, place a restriction 
+        // (10 ps by default) on the minimum time granularity.  The net result is that 
+        // if the requested increase in time is negative or less than 10 ps, then just 
+        // increase the previous timestamp by 10 instead of taking on the new simulation time.
+        if (m_currSimTime != record->simTime)
+        {
+            if (m_currSimTime == uint64(-1))
+                m_currTime = record->simTime;
+            else
+            {
+                if (m_currTime > record->simTime - params.WavesDT)
+                    m_currTime += params.WavesDT;
+                else
+                    m_currTime = record->simTime;
+            }
+            m_currSimTime = record->simTime;
+            dumpTime(m_currTime);
+        }
+
+        dumpValue(record->id, (const byte *) (record + 1), record->undefined, record->sizeInBits);
+    }
+
+    // Recycle the storage
+    {
+        descore::ScopedSpinLock lock(m_batchLock);
+        for (i = 0 ; i < (int) batch->buffers.size() ; i++)
+        {
+            if (batch->buffers[i].capacity == 0x10000)
+                m_freeData.push_back(batch->buffers[i].data);
+            else
+                delete[] batch->buffers[i].data;
+        }
+    }
+    delete batch;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -722,16 +1447,94 @@ void WavesFile::valueChange (uint32 id, const byte *value, bool undefined, int s
 // VcdWaveFile
 //
 ////////////////////////////////////////////////////////////////////////////////
+
+// Binary representation of every byte value, most significant bit first
+static char s_byteBits[256][8];
+
+struct VcdStaticInitialization
+{
+    VcdStaticInitialization ()
+    {
+        for (int b = 0 ; b < 256 ; b++)
+        {
+            for (int i = 0 ; i < 8 ; i++)
+                s_byteBits[b][i] = '0' + ((b >> (7 - i)) & 1);
+        }
+    }
+} vcdStaticInitialization;
+
+VcdWavesFile::VcdWavesFile () : 
+m_nextId(33),
+m_buffer(NULL),
+m_size(0),
+m_capacity(0x100000 + CASCADE_MAX_PORT_SIZE),
+m_stream(NULL)
+{
+    m_buffer = new char[m_capacity];
+}
+
 VcdWavesFile::~VcdWavesFile ()
 {
-    if (m_file && (Sim::simTime > m_currTime))
-        dumpTime(Sim::simTime);
+    drain();
+    if (m_file)
+    {
+        if (Sim::simTime > m_currTime)
+            dumpTime(Sim::simTime);
+        endFile();
+    }
+    delete[] m_buffer;
+}
+
+void VcdWavesFile::put (const char *text)
+{
+    int len = (int) strlen(text);
+    reserve(len);
+    assert_always(m_size + len <= m_capacity, "String is too long for waves file");
+    memcpy(m_buffer + m_size, text, len);
+    m_size += len;
+}
+
+void VcdWavesFile::writeBuffer (int flush)
+{
+    if (!m_stream)
+    {
+        if (m_size)
+            fwrite(m_buffer, 1, m_size, m_file);
+        m_size = 0;
+        return;
+    }
+
+    z_stream *stream = (z_stream *) m_stream;
+    stream->next_in = (Bytef *) m_buffer;
+    stream->avail_in = m_size;
+    if (m_compressed.empty())
+        m_compressed.resize(0x40000);
+    int ret;
+    do
+    {
+        stream->next_out = &m_compressed[0];
+        stream->avail_out = (uInt) m_compressed.size();
+        ret = deflate(stream, flush);
+        assert_always(ret != Z_STREAM_ERROR, "Failed to compress waves data");
+        fwrite(&m_compressed[0], 1, m_compressed.size() - stream->avail_out, m_file);
+    } while (stream->avail_in || !stream->avail_out || ((flush == Z_FINISH) && (ret != Z_STREAM_END)));
+    m_size = 0;
 }
 
 void VcdWavesFile::beginFile ()
 {
     assert(m_file);
 
+    // Compression
+    if (params.WavesCompress)
+    {
+        z_stream *stream = new z_stream;
+        memset(stream, 0, sizeof(z_stream));
+        assert_always(deflateInit2(stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK,
+            "Failed to initialize waves compression");
+        m_stream = stream;
+    }
+
     // Date
     time_t ltime;
     char t[64];
@@ -742,19 +1545,42 @@ void VcdWavesFile::beginFile ()
     ctime_r(&ltime, t);
 #endif
     t[strlen(t)-1] = '\0';
-    fprintf(m_file, "$date      %s\n$end\n\n", t);
+    put(strbuff("$date      %s\n$end\n\n", t));
 
     // Version
-    fprintf(m_file, "$version   Cascade version %s\n$end\n\n", CASCADE_VERSION);
+    put(strbuff("$version   Cascade version %s\n$end\n\n", CASCADE_VERSION));
 
     // Timescale
-    fprintf(m_file, "$timescale %s\n$end\n\n", **params.WavesTimescale);
+    put(strbuff("$timescale %s\n$end\n\n", **params.WavesTimescale));
+}
+
+void VcdWavesFile::endFile ()
+{
+    assert(m_file);
+    if (m_stream)
+    {
+        z_stream *stream = (z_stream *) m_stream;
+        writeBuffer(Z_FINISH);
+        deflateEnd(stream);
+        delete stream;
+        m_stream = NULL;
+    }
+    else
+        writeBuffer(0);
+    fflush(m_file);
+}
+
+void VcdWavesFile::flushFile ()
+{
+    assert(m_file);
+    writeBuffer(m_stream ? Z_SYNC_FLUSH : 0);
+    fflush(m_file);
 }
 
 void VcdWavesFile::beginComponent (const char *name)
 {
     assert(m_file);
-    fprintf(m_file, "$scope module %s $end\n", name);
+    put(strbuff("$scope module %s $end\n", name));
 }
 
 uint32 VcdWavesFile::addSignal (const char *name, int sizeInBits)
@@ -769,7 +1595,7 @@ uint32 VcdWavesFile::addSignal (const char *name, int sizeInBits)
     id[4] = 0;
     uint32 ret = id32 = m_nextId;
 
-    fprintf(m_file, "$var wire %d %s %s $end\n", sizeInBits, id, name);
+    put(strbuff("$var wire %d %s %s $end\n", sizeInBits, id, name));
     int i = 0;
     while (++id[i] == 127)
     {
@@ -786,45 +1612,73 @@ uint32 VcdWavesFile::addSignal (const char *name, int sizeInBits)
 void VcdWavesFile::endComponent ()
 {
     assert(m_file);
-    fprintf(m_file, "$upscope $end\n");
+    put("$upscope $end\n");
 }
 
 void VcdWavesFile::endSignals ()
 {
     assert(m_file);
-    fprintf(m_file, "\n$enddefinitions $end\n\n");
+    put("\n$enddefinitions $end\n\n");
 }
 
 void VcdWavesFile::dumpTime (uint64 time)
 {
     assert(m_file);
-    fprintf(m_file, "#%" PRId64 "\n", time);
+    reserve(24);
+
+    char digits[24];
+    int numDigits = 0;
+    do
+    {
+        digits[numDigits++] = (char) ('0' + time % 10);
+        time /= 10;
+    } while (time);
+
+    char *p = m_buffer + m_size;
+    *p++ = '#';
+    while (numDigits)
+        *p++ = digits[--numDigits];
+    *p++ = '\n';
+    m_size = (int) (p - m_buffer);
 }
 
 void VcdWavesFile::dumpValue (uint32 id, const byte *value, bool undefined, int sizeInBits)
 {
     assert(m_file);
     assert(id);
+    reserve(sizeInBits + 8);
 
-    union
-    {
-        uint32 id32;
-        byte   id8[5];
-    };
-    id32 = id;
-    id8[4] = 0;
-
-    descore::ScopedSpinLock lock(m_lock);
+    char *p = m_buffer + m_size;
     if (sizeInBits == 1)
-        fputc(undefined ? 'x' : '0' + (*value & 1), m_file);
+        *p++ = undefined ? 'x' : '0' + (*value & 1);
     else
     {
-        fputc('b', m_file);
-        for (int i = sizeInBits - 1 ; i >= 0 ; i--)
-            fputc(undefined ? 'x' : '0' + ((value[i/8] >> (i&7)) & 1), m_file);
-        fputc(' ', m_file);
+        *p++ = 'b';
+        if (undefined)
+        {
+            memset(p, 'x', sizeInBits);
+            p += sizeInBits;
+        }
+        else
+        {
+            // Most significant partial byte, then whole bytes from the table
+            int numBytes = sizeInBits / 8;
+            for (int i = (sizeInBits & 7) - 1 ; i >= 0 ; i--)
+                *p++ = '0' + ((value[numBytes] >> i) & 1);
+            for (int i = numBytes - 1 ; i >= 0 ; i--)
+            {
+                memcpy(p, s_byteBits[value[i]], 8);
+                p += 8;
+            }
+        }
+        *p++ = ' ';
     }
-    fprintf(m_file, "%s\n", id8);
+
+    // The id characters are stored least significant byte first
+    for ( ; id ; id >>= 8)
+        *p++ = (char) id;
+    *p++ = '\n';
+    m_size = (int) (p - m_buffer);
 }
 
 END_NAMESPACE_CASCADE
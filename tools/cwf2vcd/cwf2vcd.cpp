@@ -0,0 +1,87 @@
+/*
+Copyright 2007, D. E. Shaw Research.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+* Redistributions of source code must retain the above copyright
+  notice, this list of conditions, and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions, and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+* Neither the name of D. E. Shaw Research nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+//////////////////////////////////////////////////////////////////////
+//
+// cwf2vcd.cpp
+//
+// Copyright (C) 2026 D. E. Shaw Research
+//
+// Created: 10/18/2026
+//
+// Convert a cwf waves file (cascade.WavesFormat = Cwf) to VCD:
+//
+//   cwf2vcd [-start <time>] [-end <time>] <file.cwf> [<file.vcd>]
+//
+// If no output file is specified then the .cwf extension is replaced
+// with .vcd.  If -start or -end is specified (in the time units of the
+// waves file), then only that window of time is converted.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cascade/Cascade.hpp>
+
+int main (int argc, char *argv[])
+{
+    uint64 startTime = 0;
+    uint64 endTime = uint64(-1);
+    for ( ; (argc > 2) && argv[1][0] == '-' ; argc -= 2, argv += 2)
+    {
+        if (!strcmp(argv[1], "-start"))
+            startTime = strtoull(argv[2], NULL, 0);
+        else if (!strcmp(argv[1], "-end"))
+            endTime = strtoull(argv[2], NULL, 0);
+        else
+            break;
+    }
+
+    if ((argc < 2) || (argc > 3) || (argv[1][0] == '-'))
+    {
+        fprintf(stderr, "Usage: cwf2vcd [-start <time>] [-end <time>] <file.cwf> [<file.vcd>]\n");
+        return 1;
+    }
+
+    string vcdFilename;
+    if (argc == 3)
+        vcdFilename = argv[2];
+    else
+    {
+        vcdFilename = argv[1];
+        size_t len = vcdFilename.size();
+        if ((len > 4) && (vcdFilename.substr(len - 4) == ".cwf"))
+            vcdFilename.resize(len - 4);
+        vcdFilename += ".vcd";
+    }
+
+    Cascade::Waves::convertToVcd(argv[1], vcdFilename.c_str(), startTime, endTime);
+    return 0;
+}